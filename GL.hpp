@@ -8,7 +8,15 @@
 #undef near
 #undef min
 #undef max
+#elif defined(GL_INSTRUMENT)
+//instrumented builds call every entry point through a (wrapped) pointer, see gl_instrument.hpp:
+#include "gl_shims.hpp"
 #else
 #define GL_GLEXT_PROTOTYPES 1
 #include "glcorearb.h"
 #endif
+
+//'jam -sGL_TRACE=1' builds route GL calls through a recorder (see gl_trace.hpp):
+#ifdef GL_TRACE
+#include "gl_trace.hpp"
+#endif
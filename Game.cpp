@@ -4,50 +4,128 @@
 #include "read_chunk.hpp" //helper for reading a vector of structures from a file
 #include "data_path.hpp" //helper to get paths relative to executable
 #include "tilt_escape.hpp" // Helper for parsing through map files
+#include "vertex_layout.hpp" //compile-time descriptions of vertex formats
+#include "asset_pack.hpp" //asset files, mapped in place or inflated from assets.pak
+#include "mesh_index.hpp" //in-place search of the meshes blob's name table
+#include "frame_uniforms.hpp" //uniform block for per-frame camera + lighting
+#include "object_uniforms.hpp" //uniform block for per-draw transforms
+#include "gl_state.hpp" //drops redundant state changes
+#include "render_list.hpp" //sorted per-frame draw commands
+#include "cpu_profiler.hpp" //scoped CPU timings (PROFILE_SCOPE)
+#include "alloc_tracker.hpp" //per-frame allocation counts (ALLOC_TAG)
 
 #include <glm/gtc/type_ptr.hpp>
 
 #include <iostream>
 #include <fstream>
-#include <map>
 #include <cstddef>
 #include <random>
 #include <vector>
 #include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <future>
 
-//helper defined later; throws if shader compilation fails:
-static GLuint compile_shader(GLenum type, std::string const &source);
+//helper defined later; fills the bound GL_ARRAY_BUFFER from a vertex data chunk:
+static void upload_mesh_vertices(std::string const &magic, ChunkView const &chunk);
 static float calculate_acceleration(float incline_angle, float gravity);
 static glm::vec2 calculate_displacement(float time, glm::vec2 velocity, glm::vec2 acceletation);
 
-Game::Game() {
+Game::Assets Game::load_assets(StartupTimeline *timeline) {
+	typedef StartupTimeline::Clock Clock;
+	Assets assets;
+
+	assets.level_names.push_back("level1.map");
+	assets.level_names.push_back("level2.map");
+	assets.level_names.push_back("level3.map");
+	assets.level_names.push_back("level4.map");
+	assets.level_names.push_back("level5.map");
+
+	//the level files are loaded, and the first level parsed, on their own worker while the blob is loaded:
+	struct Levels {
+		std::vector< std::unique_ptr< Asset > > files;
+		TiltEscape::Level first;
+	};
+	std::vector< std::string > level_names = assets.level_names;
+	std::future< Levels > levels = std::async(std::launch::async, [level_names, timeline]() {
+		cpu_profiler_thread_name("level worker");
+		PROFILE_SCOPE("load levels");
+		Clock::time_point begin = Clock::now();
+		Levels ret;
+		for (auto const &name : level_names) {
+			try {
+				ret.files.emplace_back(load_asset(name));
+			} catch (std::runtime_error &e) {
+				std::cerr << "failed to open " << name << '\n';
+				ret.files.emplace_back(nullptr);
+			}
+		}
+		if (ret.files[0]) ret.first.parse_level(ret.files[0]->begin(), ret.files[0]->end());
+		if (timeline) timeline->record("load levels", "level worker", begin, Clock::now());
+		return ret;
+	});
+
+	{ //load mesh data from a binary blob:
+		PROFILE_SCOPE("load meshes.blob");
+		Clock::time_point begin = Clock::now();
+		//the blob is mapped (or inflated from the asset pack) rather than read, so vertex data can be uploaded from where it is:
+		assets.meshes_blob = load_asset("meshes.blob");
+		Asset const &blob = *assets.meshes_blob;
+		if (blob.mapped) blob.mapped->advise_sequential();
+		char const *at = blob.begin();
+		//The blob will be made up of three chunks:
+		// the first chunk will be vertex data (interleaved position/normal/color)
+		// the second chunk will be characters
+		// the third chunk will be an index, mapping a name (range of characters) to a mesh (range of vertex data)
+
+		//read vertex data (in place):
+		assets.vertex_magic = peek_chunk_magic(at, blob.end());
+		size_t vertex_size = (assets.vertex_magic == PackedPosNorColVertex::chunk_magic() ? sizeof(PackedPosNorColVertex) : sizeof(PosNorColVertex));
+		assets.vertices = read_chunk(&at, blob.end(), assets.vertex_magic, vertex_size);
+		size_t vertex_count = assets.vertices.size / vertex_size;
+
+		//read character data (for names):
+		ChunkView names = read_chunk(&at, blob.end(), "str0");
+
+		//read index (searched in place, see mesh_index.hpp):
+		ChunkView index_chunk = read_chunk(&at, blob.end(), "idx0", sizeof(MeshIndex::Entry));
+		assets.mesh_index.reset(new MeshIndex(names, index_chunk, vertex_count));
+
+		if (at != blob.end()) {
+			std::cerr << "WARNING: trailing data in meshes file." << std::endl;
+		}
+		if (timeline) timeline->record("load meshes.blob", "asset worker", begin, Clock::now());
+	}
+
+	Levels loaded = levels.get();
+	assets.level_files = std::move(loaded.files);
+	assets.level = std::move(loaded.first);
+	return assets;
+}
+
+Game::Game(Assets &&assets) : shaders(data_path("shader-cache")) {
 
 	{ //create an opengl program to perform sun/sky (well, directional+hemispherical) lighting:
-		GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER,
+		//(compile and link run in the background; see resolve_simple_shading for where the result is first used)
+		simple_shading.handle = shaders.submit("simple_shading",
 			"#version 330\n"
-			"uniform mat4 object_to_clip;\n"
-			"uniform mat4x3 object_to_light;\n"
-			"uniform mat3 normal_to_light;\n"
-			"layout(location=0) in vec4 Position;\n" //note: layout keyword used to make sure that the location-0 attribute is always bound to something
-			"in vec3 Normal;\n"
-			"in vec4 Color;\n"
+			FRAME_UNIFORMS_GLSL
+			OBJECT_UNIFORMS_GLSL
+			//note: attribute locations are fixed so that the vertex array object can be set up without waiting for the program to link:
+			"layout(location=0) in vec4 Position;\n"
+			"layout(location=1) in vec3 Normal;\n"
+			"layout(location=2) in vec4 Color;\n"
 			"out vec3 position;\n"
 			"out vec3 normal;\n"
 			"out vec4 color;\n"
 			"void main() {\n"
-			"	gl_Position = object_to_clip * Position;\n"
 			"	position = object_to_light * Position;\n"
+			"	gl_Position = world_to_clip * vec4(position, 1.0);\n"
 			"	normal = normal_to_light * Normal;\n"
 			"	color = Color;\n"
-			"}\n"
-		);
-
-		GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER,
+			"}\n",
 			"#version 330\n"
-			"uniform vec3 sun_direction;\n"
-			"uniform vec3 sun_color;\n"
-			"uniform vec3 sky_direction;\n"
-			"uniform vec3 sky_color;\n"
+			FRAME_UNIFORMS_GLSL
 			"in vec3 position;\n"
 			"in vec3 normal;\n"
 			"in vec4 color;\n"
@@ -56,190 +134,114 @@ Game::Game() {
 			"	vec3 total_light = vec3(0.0, 0.0, 0.0);\n"
 			"	vec3 n = normalize(normal);\n"
 			"	{ //sky (hemisphere) light:\n"
-			"		vec3 l = sky_direction;\n"
+			"		vec3 l = sky_direction.xyz;\n"
 			"		float nl = 0.5 + 0.5 * dot(n,l);\n"
-			"		total_light += nl * sky_color;\n"
+			"		total_light += nl * sky_color.rgb;\n"
 			"	}\n"
 			"	{ //sun (directional) light:\n"
-			"		vec3 l = sun_direction;\n"
+			"		vec3 l = sun_direction.xyz;\n"
 			"		float nl = max(0.0, dot(n,l));\n"
-			"		total_light += nl * sun_color;\n"
+			"		total_light += nl * sun_color.rgb;\n"
 			"	}\n"
 			"	fragColor = vec4(color.rgb * total_light, color.a);\n"
 			"}\n"
 		);
-
-		simple_shading.program = glCreateProgram();
-		glAttachShader(simple_shading.program, vertex_shader);
-		glAttachShader(simple_shading.program, fragment_shader);
-		//shaders are reference counted so this makes sure they are freed after program is deleted:
-		glDeleteShader(vertex_shader);
-		glDeleteShader(fragment_shader);
-
-		//link the shader program and throw errors if linking fails:
-		glLinkProgram(simple_shading.program);
-		GLint link_status = GL_FALSE;
-		glGetProgramiv(simple_shading.program, GL_LINK_STATUS, &link_status);
-		if (link_status != GL_TRUE) {
-			std::cerr << "Failed to link shader program." << std::endl;
-			GLint info_log_length = 0;
-			glGetProgramiv(simple_shading.program, GL_INFO_LOG_LENGTH, &info_log_length);
-			std::vector< GLchar > info_log(info_log_length, 0);
-			GLsizei length = 0;
-			glGetProgramInfoLog(simple_shading.program, GLsizei(info_log.size()), &length, &info_log[0]);
-			std::cerr << "Info log: " << std::string(info_log.begin(), info_log.begin() + length);
-			throw std::runtime_error("failed to link program");
-		}
 	}
 
-	{ //read back uniform and attribute locations from the shader program:
-		simple_shading.object_to_clip_mat4 = glGetUniformLocation(simple_shading.program, "object_to_clip");
-		simple_shading.object_to_light_mat4x3 = glGetUniformLocation(simple_shading.program, "object_to_light");
-		simple_shading.normal_to_light_mat3 = glGetUniformLocation(simple_shading.program, "normal_to_light");
-
-		simple_shading.sun_direction_vec3 = glGetUniformLocation(simple_shading.program, "sun_direction");
-		simple_shading.sun_color_vec3 = glGetUniformLocation(simple_shading.program, "sun_color");
-		simple_shading.sky_direction_vec3 = glGetUniformLocation(simple_shading.program, "sky_direction");
-		simple_shading.sky_color_vec3 = glGetUniformLocation(simple_shading.program, "sky_color");
-
-		simple_shading.Position_vec4 = glGetAttribLocation(simple_shading.program, "Position");
-		simple_shading.Normal_vec3 = glGetAttribLocation(simple_shading.program, "Normal");
-		simple_shading.Color_vec4 = glGetAttribLocation(simple_shading.program, "Color");
+	{ //create the uniform buffer for per-frame data (shared by all programs):
+		glGenBuffers(1, &frame_uniforms_ubo);
+		gl_state().bind_buffer(GL_UNIFORM_BUFFER, frame_uniforms_ubo);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW);
+		gl_state().bind_buffer(GL_UNIFORM_BUFFER, 0);
+		gl_state().bind_buffer_base(GL_UNIFORM_BUFFER, FrameUniformsBinding, frame_uniforms_ubo);
 	}
 
-	struct Vertex {
-		glm::vec3 Position;
-		glm::vec3 Normal;
-		glm::u8vec4 Color;
-	};
-	static_assert(sizeof(Vertex) == 28, "Vertex should be packed.");
-
-	{ //load mesh data from a binary blob:
-		std::ifstream blob(data_path("meshes.blob"), std::ios::binary);
-		//The blob will be made up of three chunks:
-		// the first chunk will be vertex data (interleaved position/normal/color)
-		// the second chunk will be characters
-		// the third chunk will be an index, mapping a name (range of characters) to a mesh (range of vertex data)
+	{ //create the stream buffer per-draw data is written to each frame:
+		GLint alignment = 0;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		GLsizeiptr object_size = (sizeof(ObjectUniforms) + alignment - 1) / alignment * alignment;
+		//(room for 256 draws to start; it grows if a level needs more)
+		object_stream.reset(new StreamBuffer(GL_UNIFORM_BUFFER, 256 * object_size, alignment));
+	}
 
-		//read vertex data:
-		std::vector< Vertex > vertices;
-		read_chunk(blob, "dat0", &vertices);
+	{ //upload mesh data (see load_assets) to the graphics card:
+		glGenBuffers(1, &meshes_vbo);
+		gl_state().bind_buffer(GL_ARRAY_BUFFER, meshes_vbo);
+		upload_mesh_vertices(assets.vertex_magic, assets.vertices);
+		gl_state().bind_buffer(GL_ARRAY_BUFFER, 0);
 
-		//read character data (for names):
-		std::vector< char > names;
-		read_chunk(blob, "str0", &names);
-
-		//read index:
-		struct IndexEntry {
-			uint32_t name_begin;
-			uint32_t name_end;
-			uint32_t vertex_begin;
-			uint32_t vertex_end;
-		};
-		static_assert(sizeof(IndexEntry) == 16, "IndexEntry should be packed.");
-
-		std::vector< IndexEntry > index_entries;
-		read_chunk(blob, "idx0", &index_entries);
-
-		if (blob.peek() != EOF) {
-			std::cerr << "WARNING: trailing data in meshes file." << std::endl;
-		}
+		MeshIndex const &index = *assets.mesh_index;
 
-		//upload vertex data to the graphics card:
-		glGenBuffers(1, &meshes_vbo);
-		glBindBuffer(GL_ARRAY_BUFFER, meshes_vbo);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-		//create map to store index entries:
-		std::map< std::string, Mesh > index;
-		for (IndexEntry const &e : index_entries) {
-			if (e.name_begin > e.name_end || e.name_end > names.size()) {
-				throw std::runtime_error("invalid name indices in index.");
-			}
-			if (e.vertex_begin > e.vertex_end || e.vertex_end > vertices.size()) {
-				throw std::runtime_error("invalid vertex indices in index.");
-			}
+		//copy draw ranges out of the index, so that a mesh handle is also an index into 'meshes':
+		meshes.reserve(index.size());
+		for (MeshHandle handle = 0; handle < index.size(); ++handle) {
 			Mesh mesh;
-			mesh.first = e.vertex_begin;
-			mesh.count = e.vertex_end - e.vertex_begin;
-			auto ret = index.insert(std::make_pair(
-				std::string(names.begin() + e.name_begin, names.begin() + e.name_end),
-				mesh));
-			if (!ret.second) {
-				throw std::runtime_error("duplicate name in index.");
-			}
+			mesh.first = index[handle].vertex_begin;
+			mesh.count = index[handle].vertex_end - index[handle].vertex_begin;
+			meshes.emplace_back(mesh);
 		}
 
-		//look up into index map to extract meshes:
-		auto lookup = [&index](std::string const &name) -> Mesh {
-			auto f = index.find(name);
-			if (f == index.end()) {
-				throw std::runtime_error("Mesh named '" + name + "' does not appear in index.");
-			}
-			return f->second;
-		};
-
 		// Look for the new meshes that I created
-		player_mesh = lookup("Player");
-		guard_mesh = lookup("Guard");
-		guard_view_mesh = lookup("GuardVision");
-		wall_mesh = lookup("Wall");
-		floor_mesh = lookup("Floor");
+		player_mesh = index.lookup("Player");
+		guard_mesh = index.lookup("Guard");
+		guard_view_mesh = index.lookup("GuardVision");
+		wall_mesh = index.lookup("Wall");
+		floor_mesh = index.lookup("Floor");
 	}
 
 	{ //create vertex array object to hold the map from the mesh vertex buffer to shader program attributes:
 		glGenVertexArrays(1, &meshes_for_simple_shading_vao);
-		glBindVertexArray(meshes_for_simple_shading_vao);
-		glBindBuffer(GL_ARRAY_BUFFER, meshes_vbo);
-		//note that I'm specifying a 3-vector for a 4-vector attribute here, and this is okay to do:
-		glVertexAttribPointer(simple_shading.Position_vec4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLbyte *)0 + offsetof(Vertex, Position));
-		glEnableVertexAttribArray(simple_shading.Position_vec4);
-		if (simple_shading.Normal_vec3 != -1U) {
-			glVertexAttribPointer(simple_shading.Normal_vec3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLbyte *)0 + offsetof(Vertex, Normal));
-			glEnableVertexAttribArray(simple_shading.Normal_vec3);
-		}
-		if (simple_shading.Color_vec4 != -1U) {
-			glVertexAttribPointer(simple_shading.Color_vec4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (GLbyte *)0 + offsetof(Vertex, Color));
-			glEnableVertexAttribArray(simple_shading.Color_vec4);
-		}
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		gl_state().bind_vertex_array(meshes_for_simple_shading_vao);
+		gl_state().bind_buffer(GL_ARRAY_BUFFER, meshes_vbo);
+		//note: packed normals have four components, and this is okay for the vec3 Normal attribute:
+		PackedPosNorColLayout::bind(simple_shading.Position_vec4, simple_shading.Normal_vec3, simple_shading.Color_vec4);
+		gl_state().bind_buffer(GL_ARRAY_BUFFER, 0);
 	}
 
 	GL_ERRORS();
 
 	//----------------
 
-	level_names.push_back("level1.map");
-	level_names.push_back("level2.map");
-    level_names.push_back("level3.map");
-	level_names.push_back("level4.map");
-	level_names.push_back("level5.map");
-
-	level.load_level(level_names[level_index]);
+	level_names = std::move(assets.level_names);
+	level_files = std::move(assets.level_files);
+	level = std::move(assets.level);
 	board_size = glm::uvec2(level.get_length(),level.get_height());
 	
 	// Initialize the discrete rotations for the guards vision
-	guard_vision_rotations[TiltEscape::LookDirection::UP] = glm::angleAxis(0.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-	guard_vision_rotations[TiltEscape::LookDirection::UP_LEFT] = glm::angleAxis(0.7f, glm::vec3(0.0f, 1.0f, 0.0f));
-	guard_vision_rotations[TiltEscape::LookDirection::LEFT] = glm::angleAxis(1.5f, glm::vec3(0.0f, 1.0f, 0.0f));
-	guard_vision_rotations[TiltEscape::LookDirection::DOWN_LEFT] = glm::angleAxis(2.5f, glm::vec3(0.0f, 1.0f, 0.0f));
-	guard_vision_rotations[TiltEscape::LookDirection::DOWN] = glm::angleAxis(3.15f, glm::vec3(0.0f, 1.0f, 0.0f));
-	guard_vision_rotations[TiltEscape::LookDirection::DOWN_RIGHT] = glm::angleAxis(-2.5f, glm::vec3(0.0f, 1.0f, 0.0f));
-	guard_vision_rotations[TiltEscape::LookDirection::RIGHT] = glm::angleAxis(-1.5f, glm::vec3(0.0f, 1.0f, 0.0f));
-	guard_vision_rotations[TiltEscape::LookDirection::UP_RIGHT] = glm::angleAxis(-0.7f, glm::vec3(0.0f, 1.0f, 0.0f));
+	guard_vision_rotations[int(TiltEscape::LookDirection::UP)] = glm::angleAxis(0.0f, glm::vec3(0.0f, 1.0f, 0.0f));
+	guard_vision_rotations[int(TiltEscape::LookDirection::UP_LEFT)] = glm::angleAxis(0.7f, glm::vec3(0.0f, 1.0f, 0.0f));
+	guard_vision_rotations[int(TiltEscape::LookDirection::LEFT)] = glm::angleAxis(1.5f, glm::vec3(0.0f, 1.0f, 0.0f));
+	guard_vision_rotations[int(TiltEscape::LookDirection::DOWN_LEFT)] = glm::angleAxis(2.5f, glm::vec3(0.0f, 1.0f, 0.0f));
+	guard_vision_rotations[int(TiltEscape::LookDirection::DOWN)] = glm::angleAxis(3.15f, glm::vec3(0.0f, 1.0f, 0.0f));
+	guard_vision_rotations[int(TiltEscape::LookDirection::DOWN_RIGHT)] = glm::angleAxis(-2.5f, glm::vec3(0.0f, 1.0f, 0.0f));
+	guard_vision_rotations[int(TiltEscape::LookDirection::RIGHT)] = glm::angleAxis(-1.5f, glm::vec3(0.0f, 1.0f, 0.0f));
+	guard_vision_rotations[int(TiltEscape::LookDirection::UP_RIGHT)] = glm::angleAxis(-0.7f, glm::vec3(0.0f, 1.0f, 0.0f));
+
+	//so there is something to draw before the first update:
+	publish_snapshot();
 }
 
 Game::~Game() {
+	gpu_profiler.report(std::cout);
+	object_stream->report(std::cout);
+
 	glDeleteVertexArrays(1, &meshes_for_simple_shading_vao);
 	meshes_for_simple_shading_vao = -1U;
 
 	glDeleteBuffers(1, &meshes_vbo);
 	meshes_vbo = -1U;
 
-	glDeleteProgram(simple_shading.program);
+	glDeleteBuffers(1, &frame_uniforms_ubo);
+	frame_uniforms_ubo = -1U;
+
+	object_stream.reset();
+
+	//(programs are deleted by 'shaders')
 	simple_shading.program = -1U;
 
+	//deleting bound objects unbinds them:
+	gl_state().invalidate();
+
 	GL_ERRORS();
 }
 
@@ -249,40 +251,73 @@ bool Game::handle_event(SDL_Event const &evt, glm::uvec2 window_size) {
 		return false;
 	}
 
+	//when a control changes (stamped after the change, so update never sees the stamp without the change):
+	auto stamp_input = [this]() {
+		InputClock::rep expected = 0;
+		unseen_input.compare_exchange_strong(expected, InputClock::now().time_since_epoch().count());
+	};
+
 	//handle tracking the state of WSAD for roll control:
 	if (evt.type == SDL_KEYDOWN || evt.type == SDL_KEYUP) {
 		if (evt.key.keysym.scancode == SDL_SCANCODE_W) {
 			controls.tilt_up = (evt.type == SDL_KEYDOWN);
+			stamp_input();
 			return true;
 		} else if (evt.key.keysym.scancode == SDL_SCANCODE_S) {
 			controls.tilt_down = (evt.type == SDL_KEYDOWN);
+			stamp_input();
 			return true;
 		} else if (evt.key.keysym.scancode == SDL_SCANCODE_A) {
 			controls.tilt_left = (evt.type == SDL_KEYDOWN);
+			stamp_input();
 			return true;
 		} else if (evt.key.keysym.scancode == SDL_SCANCODE_D) {
 			controls.tilt_right = (evt.type == SDL_KEYDOWN);
+			stamp_input();
 			return true;
 		}
 	}
+
+	//F2 prints GPU pass timings and streaming stats so far:
+	if (evt.type == SDL_KEYDOWN && evt.key.keysym.scancode == SDL_SCANCODE_F2) {
+		gpu_profiler.report(std::cout);
+		object_stream->report(std::cout);
+		return true;
+	}
 	
 	return false;
 }
 
 void Game::update(float elapsed) {
+	PROFILE_SCOPE("update");
+	ALLOC_TAG("update");
+
+	//(taken before the controls are read, so the snapshot this update publishes reflects the input)
+	InputClock::rep input = unseen_input.exchange(0);
+	if (input != 0 && unpublished_input == 0) unpublished_input = input;
 
 	//check game over
 	if (game_over()) {
 		next_level();
+		publish_snapshot();
 		return;
 	}
 
-	if (level.check_caught_by_guard() || level.fell_in_hole()) {
+	bool lost;
+	{
+		PROFILE_SCOPE("caught/fell check");
+		lost = level.check_caught_by_guard() || level.fell_in_hole();
+	}
+	if (lost) {
 		reset();
+		publish_snapshot();
 		return;
 	}
 
-	level.update(elapsed);
+	{
+		PROFILE_SCOPE("guard update");
+		level.update(elapsed);
+	}
 
 	// My own version of physics
 	float acc_x = 0.0f;
@@ -310,107 +345,87 @@ void Game::update(float elapsed) {
 	level.player.position.y = next_pos_y;
 
 	// Collision resolution code adapted from http://learnopengl.com/In-Practice/2D-Game/Collisions/Collision-resolution
-	for (Uint32 i = 0; i < level.walls.size(); i++)
 	{
-		TiltEscape::Collision collision = level.check_wall_collision(level.walls[i]);
-		if (std::get<0>(collision))
+		PROFILE_SCOPE("collision");
+		for (Uint32 i = 0; i < level.walls.size(); i++)
 		{
-			TiltEscape::Direction dir = std::get<1>(collision);
-			glm::vec2 diff_vector = std::get<2>(collision);
-
-			if (dir == TiltEscape::Direction::LEFT || dir == TiltEscape::Direction::RIGHT)
-			{
-				level.player.velocity.x = 0;
-				GLfloat penetration = level.player.radius - std::abs(diff_vector.x);
-				if (dir == TiltEscape::Direction::LEFT)
-				{
-					level.player.position.x += penetration;
-				}
-				else
-				{
-					level.player.position.x -= penetration;
-				}
-			}
-			else
+			TiltEscape::Collision collision = level.check_wall_collision(level.walls[i]);
+			if (std::get<0>(collision))
 			{
-				level.player.velocity.y = 0;
-				GLfloat penetration = level.player.radius - std::abs(diff_vector.y);
-				if (dir == TiltEscape::Direction::UP)
+				TiltEscape::Direction dir = std::get<1>(collision);
+				glm::vec2 diff_vector = std::get<2>(collision);
+
+				if (dir == TiltEscape::Direction::LEFT || dir == TiltEscape::Direction::RIGHT)
 				{
-					level.player.position.y -= penetration;
+					level.player.velocity.x = 0;
+					GLfloat penetration = level.player.radius - std::abs(diff_vector.x);
+					if (dir == TiltEscape::Direction::LEFT)
+					{
+						level.player.position.x += penetration;
+					}
+					else
+					{
+						level.player.position.x -= penetration;
+					}
 				}
 				else
 				{
-					level.player.position.y += penetration;
+					level.player.velocity.y = 0;
+					GLfloat penetration = level.player.radius - std::abs(diff_vector.y);
+					if (dir == TiltEscape::Direction::UP)
+					{
+						level.player.position.y -= penetration;
+					}
+					else
+					{
+						level.player.position.y += penetration;
+					}
 				}
 			}
 		}
 	}
 
-		
+	publish_snapshot();
 }
 
-void Game::draw(glm::uvec2 drawable_size) {
-	//Set up a transformation matrix to fit the board in the window:
-	glm::mat4 world_to_clip;
-	{
-		float aspect = float(drawable_size.x) / float(drawable_size.y);
-
-		//want scale such that board * scale fits in [-aspect,aspect]x[-1.0,1.0] screen box:
-		float scale = glm::min(
-			2.0f * aspect / float(board_size.x * 3),
-			2.0f / float(board_size.y * 3)
-		);
-
-		//center of board will be placed at center of screen:
-		glm::vec2 center = glm::vec2(board_size);
-
-		//NOTE: glm matrices are specified in column-major order
-		world_to_clip = glm::mat4(
-			scale / aspect, 0.0f, 0.0f, 0.0f,
-			0.0f, scale, 0.0f, 0.0f,
-			0.0f, 0.0f,-1.0f, 0.0f,
-			-(scale / aspect) * center.x, -scale * center.y, 0.0f, 1.0f
-		);
+void Game::publish_snapshot() {
+	PROFILE_SCOPE("publish snapshot");
+	Snapshot &snapshot = snapshots.write_buffer();
+	build_render_list(snapshot.render_list);
+	snapshot.board_size = board_size;
+	snapshot.guards = uint32_t(level.guards.size());
+	snapshot.walls = uint32_t(level.walls.size());
+
+	//input times ride on every snapshot until draw reads one of them (it may skip some):
+	snapshot.serial = ++published_serial;
+	if (undrawn_input != 0 && drawn_serial.load() >= undrawn_input_serial) undrawn_input = 0;
+	if (undrawn_input == 0 && unpublished_input != 0) {
+		undrawn_input = unpublished_input;
+		undrawn_input_serial = snapshot.serial;
+		unpublished_input = 0;
 	}
+	snapshot.input_time = undrawn_input;
 
-	//set up graphics pipeline to use data from the meshes and the simple shading program:
-	glBindVertexArray(meshes_for_simple_shading_vao);
-	glUseProgram(simple_shading.program);
-
-	glUniform3fv(simple_shading.sun_color_vec3, 1, glm::value_ptr(glm::vec3(0.81f, 0.81f, 0.76f)));
-	glUniform3fv(simple_shading.sun_direction_vec3, 1, glm::value_ptr(glm::normalize(glm::vec3(-0.2f, 0.2f, 1.0f))));
-	glUniform3fv(simple_shading.sky_color_vec3, 1, glm::value_ptr(glm::vec3(0.2f, 0.2f, 0.3f)));
-	glUniform3fv(simple_shading.sky_direction_vec3, 1, glm::value_ptr(glm::vec3(0.0f, 1.0f, 0.0f)));
-
-	//helper function to draw a given mesh with a given transformation:
-	auto draw_mesh = [&](Mesh const &mesh, glm::mat4 const &object_to_world) {
-		//set up the matrix uniforms:
-		if (simple_shading.object_to_clip_mat4 != -1U) {
-			glm::mat4 object_to_clip = world_to_clip * object_to_world;
-			glUniformMatrix4fv(simple_shading.object_to_clip_mat4, 1, GL_FALSE, glm::value_ptr(object_to_clip));
-		}
-		if (simple_shading.object_to_light_mat4x3 != -1U) {
-			glUniformMatrix4x3fv(simple_shading.object_to_light_mat4x3, 1, GL_FALSE, glm::value_ptr(object_to_world));
-		}
-		if (simple_shading.normal_to_light_mat3 != -1U) {
-			//NOTE: if there isn't any non-uniform scaling in the object_to_world matrix, then the inverse transpose is the matrix itself, and computing it wastes some CPU time:
-			glm::mat3 normal_to_world = glm::inverse(glm::transpose(glm::mat3(object_to_world)));
-			glUniformMatrix3fv(simple_shading.normal_to_light_mat3, 1, GL_FALSE, glm::value_ptr(normal_to_world));
-		}
+	snapshots.publish();
+}
 
-		//draw the mesh:
-		glDrawArrays(GL_TRIANGLES, mesh.first, mesh.count);
+void Game::build_render_list(RenderList &list) {
+	list.clear();
+
+	//the camera looks down -z (see world_to_clip in draw), so depth is -z:
+	auto add = [this, &list](MeshHandle mesh, glm::mat4 const &object_to_world, bool transparent) {
+		list.add(SimpleShadingProgram, mesh, object_to_world, -object_to_world[3].z, transparent);
 	};
 
 	// Draw the Player
-	draw_mesh(player_mesh,
+	add(player_mesh,
 		glm::mat4(
 			1.0f, 0.0f, 0.0f, 0.0f,
 			0.0f, 1.0f, 0.0f, 0.0f,
 			0.0f, 0.0f, 1.0f, 0.0f,
 			level.player.position.x * 2, level.player.position.y * 2, 0.0f, 1.0f
-		)
+		),
+		false
 	);
 
 	glm::quat rotate_90 = glm::angleAxis(1.0f, glm::vec3(1.0f, 0.0f, 0.0f));
@@ -418,39 +433,42 @@ void Game::draw(glm::uvec2 drawable_size) {
 	// Draw all the guards
 	for (Uint32 i = 0; i < level.guards.size(); i++)
 	{
-		draw_mesh(guard_mesh,
+		add(guard_mesh,
 			glm::mat4(
 				1.0f, 0.0f, 0.0f, 0.0f,
 				0.0f, 1.0f, 0.0f, 0.0f,
 				0.0f, 0.0f, 1.0f, 0.0f,
 				level.guards[i].position.x * 2, level.guards[i].position.y * 2, 0.0f, 1.0f
-			)
+			),
+			false
 		);
 		
 		glm::vec2 offset = level.guards[i].get_fov_offset();
 
-		// Draw the  guards FOV
-		draw_mesh(guard_view_mesh,
+		// Draw the  guards FOV (blended, so drawn after everything opaque)
+		add(guard_view_mesh,
 			glm::mat4(
 				1.0f, 0.0f, 0.0f, 0.0f,
 				0.0f, 1.0f, 0.0f, 0.0f,
 				0.0f, 0.0f, 1.0f, 0.0f,
 				(level.guards[i].position.x + offset.x)* 2, (level.guards[i].position.y + offset.y) * 2, 0.0f, 1.0f
 			)
-			* glm::mat4_cast(rotate_90 * guard_vision_rotations[level.guards[i].fov.look_direction])
+			* glm::mat4_cast(rotate_90 * guard_vision_rotations[int(level.guards[i].fov.look_direction)]),
+			true
 		);
 	}
 
 	// Draw all the walls
 	for (Uint32 i = 0; i < level.walls.size(); i++)
 	{
-		draw_mesh(wall_mesh,
+		add(wall_mesh,
 			glm::mat4(
 				1.0f, 0.0f, 0.0f, 0.0f,
 				0.0f, 1.0f, 0.0f, 0.0f,
 				0.0f, 0.0f, 1.0f, 0.0f,
 				level.walls[i].position.x * 2, level.walls[i].position.y * 2, 0.0f, 1.0f
-			)
+			),
+			false
 		);
 	}
 	
@@ -461,24 +479,158 @@ void Game::draw(glm::uvec2 drawable_size) {
 		{
 			if (level.at(y,x) != 'H')
 			{
-				draw_mesh(floor_mesh,
+				add(floor_mesh,
 					glm::mat4(
 						1.0f, 0.0f, 0.0f, 0.0f,
 						0.0f, 1.0f, 0.0f, 0.0f,
 						0.0f, 0.0f, 1.0f, 0.0f,
 						x*2, y*2,-0.5f, 1.0f
-					)
+					),
+					false
 				);
 			}
 		}
 	}
 
+	list.sort();
+}
+
+char const *Game::pass_name(MeshHandle mesh) const {
+	if (mesh == player_mesh) return "player";
+	if (mesh == guard_mesh) return "guards";
+	if (mesh == guard_view_mesh) return "vision";
+	if (mesh == wall_mesh) return "walls";
+	if (mesh == floor_mesh) return "floor";
+	return "other";
+}
 
-	glUseProgram(0);
+void Game::draw(glm::uvec2 drawable_size) {
+	PROFILE_SCOPE("draw");
+	ALLOC_TAG("draw");
+	//(draw only looks at the snapshot, never at the live game state update is changing)
+	Snapshot const &snapshot = snapshots.read();
+	glm::uvec2 const &board_size = snapshot.board_size;
+
+	//(an input time seen on an earlier snapshot was already shown)
+	drawn_input_time = InputClock::time_point();
+	if (snapshot.input_time != 0 && snapshot.input_time != last_drawn_input) {
+		drawn_input_time = InputClock::time_point(InputClock::duration(snapshot.input_time));
+		last_drawn_input = snapshot.input_time;
+	}
+	drawn_serial.store(snapshot.serial);
+
+	FrameUniforms frame;
+
+	//Set up a transformation matrix to fit the board in the window:
+	glm::mat4 &world_to_clip = frame.world_to_clip;
+	{
+		float aspect = float(drawable_size.x) / float(drawable_size.y);
+
+		//want scale such that board * scale fits in [-aspect,aspect]x[-1.0,1.0] screen box:
+		float scale = glm::min(
+			2.0f * aspect / float(board_size.x * 3),
+			2.0f / float(board_size.y * 3)
+		);
+
+		//center of board will be placed at center of screen:
+		glm::vec2 center = glm::vec2(board_size);
+
+		//NOTE: glm matrices are specified in column-major order
+		world_to_clip = glm::mat4(
+			scale / aspect, 0.0f, 0.0f, 0.0f,
+			0.0f, scale, 0.0f, 0.0f,
+			0.0f, 0.0f,-1.0f, 0.0f,
+			-(scale / aspect) * center.x, -scale * center.y, 0.0f, 1.0f
+		);
+	}
+
+	//the first draw is where the program is first needed:
+	resolve_simple_shading();
+
+	//set up graphics pipeline to use data from the meshes and the simple shading program:
+	//(the state cache drops these if they are already bound from last frame)
+	gl_state().bind_vertex_array(meshes_for_simple_shading_vao);
+	gl_state().use_program(simple_shading.program);
+
+	//upload camera + lighting for the frame (used by every program) in one write:
+	frame.sun_color = glm::vec4(0.81f, 0.81f, 0.76f, 0.0f);
+	frame.sun_direction = glm::vec4(glm::normalize(glm::vec3(-0.2f, 0.2f, 1.0f)), 0.0f);
+	frame.sky_color = glm::vec4(0.2f, 0.2f, 0.3f, 0.0f);
+	frame.sky_direction = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+	gl_state().bind_buffer(GL_UNIFORM_BUFFER, frame_uniforms_ubo);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frame);
+
+	//GPU time is measured per pass (results arrive a few frames later):
+	gpu_profiler.begin_frame();
+
+	std::vector< DrawCommand > const &commands = snapshot.render_list.commands;
+
+	//write every draw's transforms straight into the stream buffer:
+	GLsizeiptr object_size = object_stream->aligned(sizeof(ObjectUniforms));
+	object_stream->begin_frame(object_size * commands.size());
+	GLintptr objects_offset = 0; //(allocations are consecutive, so draw i's data is at objects_offset + i * object_size)
+	for (size_t i = 0; i < commands.size(); ++i) {
+		void *data = nullptr;
+		GLintptr offset = object_stream->allocate(sizeof(ObjectUniforms), &data);
+		if (i == 0) objects_offset = offset;
+		write_object_uniforms(reinterpret_cast< ObjectUniforms * >(data), commands[i].object_to_world);
+	}
+	object_stream->end_writes();
+
+	draw_stats = DrawStats();
+	draw_stats.guards = snapshot.guards;
+	draw_stats.walls = snapshot.walls;
+
+	//submit the frame's draws (built and sorted in update -- see build_render_list):
+	MeshHandle run_mesh = InvalidMesh;
+	bool run_transparent = false;
+	for (size_t i = 0; i < commands.size(); ++i) {
+		DrawCommand const &cmd = commands[i];
+		//each run of one mesh in one pass is timed as part of the mesh's section
+		// (the sort puts depth before mesh, so a mesh may have several runs):
+		if (cmd.mesh != run_mesh || cmd.transparent != run_transparent) {
+			gpu_profiler.end();
+			gpu_profiler.begin(pass_name(cmd.mesh));
+			run_mesh = cmd.mesh;
+			run_transparent = cmd.transparent;
+		}
+
+		//opaque draws write depth without blending; transparent draws blend but leave depth alone:
+		gl_state().set_enabled(GL_BLEND, cmd.transparent);
+		gl_state().depth_mask(cmd.transparent ? GL_FALSE : GL_TRUE);
+
+		//(only one program so far; cmd.program would pick it)
+		Mesh const &mesh = meshes[cmd.mesh];
+		//point the 'Object' block at this draw's transforms (world_to_clip comes from the frame uniforms):
+		gl_state().bind_buffer_range(GL_UNIFORM_BUFFER, ObjectUniformsBinding, object_stream->buffer, objects_offset + i * object_size, sizeof(ObjectUniforms));
+
+		//draw the mesh:
+		glDrawArrays(GL_TRIANGLES, mesh.first, mesh.count);
+		++draw_stats.draws;
+		draw_stats.triangles += uint32_t(mesh.count / 3);
+	}
+	gpu_profiler.end();
+
+	//glClear only clears depth if depth writes are on:
+	gl_state().depth_mask(GL_TRUE);
+
+	gpu_profiler.end_frame();
+	object_stream->end_frame();
 
 	GL_ERRORS();
 }
 
+void Game::resolve_simple_shading() {
+	if (simple_shading.program != -1U) return;
+
+	//blocks (only) if the driver is still compiling:
+	simple_shading.program = shaders.get(simple_shading.handle);
+
+	//connect it to the frame and object uniforms:
+	bind_frame_uniforms(simple_shading.program);
+	bind_object_uniforms(simple_shading.program);
+}
+
 bool Game::game_over() {
 	
 	if (level.player.position.x < 0 || level.player.position.x > board_size.x + 1)
@@ -494,40 +646,77 @@ bool Game::game_over() {
 }
 
 void Game::reset() {
+	//(parsing into the cleared level reuses its memory, so restarting doesn't allocate)
 	level.clear_level();
-	level.load_level(level_names[level_index]);
+	Asset const *file = level_files[level_index].get();
+	if (file) level.parse_level(file->begin(), file->end());
 	board_size = glm::uvec2(level.get_length(),level.get_height());
 }
 
 void Game::next_level() {
-	level.clear_level();
 	level_index = (level_index + 1) % level_names.size();
-	level.load_level(level_names[level_index]);
-	board_size = glm::uvec2(level.get_length(),level.get_height());
+	reset();
+}
+
+bool Game::select_level(std::string const &name) {
+	auto found = std::find(level_names.begin(), level_names.end(), name);
+	if (found == level_names.end()) return false;
+	level_index = int(found - level_names.begin());
+	reset();
+	publish_snapshot();
+	return true;
+}
+
+uint8_t Game::get_controls() const {
+	return (controls.tilt_left ? TiltLeft : 0)
+	     | (controls.tilt_right ? TiltRight : 0)
+	     | (controls.tilt_up ? TiltUp : 0)
+	     | (controls.tilt_down ? TiltDown : 0);
+}
+
+void Game::set_controls(uint8_t bits) {
+	controls.tilt_left = (bits & TiltLeft) != 0;
+	controls.tilt_right = (bits & TiltRight) != 0;
+	controls.tilt_up = (bits & TiltUp) != 0;
+	controls.tilt_down = (bits & TiltDown) != 0;
 }
 
 
-//create and return an OpenGL vertex shader from source:
-static GLuint compile_shader(GLenum type, std::string const &source) {
-	GLuint shader = glCreateShader(type);
-	GLchar const *str = source.c_str();
-	GLint length = GLint(source.size());
-	glShaderSource(shader, 1, &str, &length);
-	glCompileShader(shader);
-	GLint compile_status = GL_FALSE;
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_status);
-	if (compile_status != GL_TRUE) {
-		std::cerr << "Failed to compile shader." << std::endl;
-		GLint info_log_length = 0;
-		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &info_log_length);
-		std::vector< GLchar > info_log(info_log_length, 0);
-		GLsizei length = 0;
-		glGetShaderInfoLog(shader, GLsizei(info_log.size()), &length, &info_log[0]);
-		std::cerr << "Info log: " << std::string(info_log.begin(), info_log.begin() + length);
-		glDeleteShader(shader);
-		throw std::runtime_error("Failed to compile shader.");
+//upload mesh vertices from a (mapped) chunk to the currently bound GL_ARRAY_BUFFER:
+static void upload_mesh_vertices(std::string const &magic, ChunkView const &chunk) {
+	if (magic == PackedPosNorColVertex::chunk_magic()) {
+		//already in the GPU format, so the driver can copy straight out of the mapping:
+		glBufferData(GL_ARRAY_BUFFER, chunk.size, chunk.data, GL_STATIC_DRAW);
+		return;
+	}
+	if (magic != PosNorColVertex::chunk_magic()) {
+		throw std::runtime_error("Unexpected vertex chunk '" + magic + "' in meshes file.");
+	}
+
+	//full-precision vertices are packed as they are streamed into the buffer in
+	// fixed-size pieces, so no full-size intermediate copy is ever held in memory:
+	const size_t PieceVertices = 4096;
+	size_t count = chunk.size / sizeof(PosNorColVertex);
+	glBufferData(GL_ARRAY_BUFFER, count * sizeof(PackedPosNorColVertex), nullptr, GL_STATIC_DRAW);
+	for (size_t begin = 0; begin < count; begin += PieceVertices) {
+		size_t end = std::min(count, begin + PieceVertices);
+		//(freshly allocated buffer, so there is nothing to synchronize with)
+		PackedPosNorColVertex *dst = reinterpret_cast< PackedPosNorColVertex * >(glMapBufferRange(GL_ARRAY_BUFFER,
+			begin * sizeof(PackedPosNorColVertex), (end - begin) * sizeof(PackedPosNorColVertex),
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+		if (!dst) {
+			throw std::runtime_error("Failed to map mesh vertex buffer.");
+		}
+		for (size_t i = begin; i < end; ++i) {
+			//(memcpy because the chunk need not be aligned in the file)
+			PosNorColVertex v;
+			std::memcpy(&v, chunk.data + i * sizeof(PosNorColVertex), sizeof(PosNorColVertex));
+			dst[i - begin] = pack_vertex(v);
+		}
+		if (glUnmapBuffer(GL_ARRAY_BUFFER) != GL_TRUE) {
+			throw std::runtime_error("Mesh vertex buffer contents were lost during upload.");
+		}
 	}
-	return shader;
 }
 
 // Find the acceleration of the ball given the incline of tge board
@@ -7,30 +7,98 @@
 #include <glm/gtc/quaternion.hpp>
 
 #include <vector>
-#include <map>
+#include <memory>
+#include <atomic>
+#include <chrono>
 
 #include "tilt_escape.hpp"
+#include "mesh_index.hpp"
+#include "asset_pack.hpp"
+#include "startup_timeline.hpp"
+#include "shader_manager.hpp"
+#include "gpu_profiler.hpp"
+#include "render_list.hpp"
+#include "triple_buffer.hpp"
+#include "stream_buffer.hpp"
 
 // The 'Game' struct holds all of the game-relevant state,
 // and is called by the main loop.
 
 struct Game {
+	//Assets holds the CPU-side data a Game is built from:
+	struct Assets {
+		std::unique_ptr< Asset > meshes_blob;
+		std::string vertex_magic; //format of 'vertices' (see vertex_layout.hpp)
+		ChunkView vertices; //(points into meshes_blob)
+		std::unique_ptr< MeshIndex > mesh_index; //(points into meshes_blob)
+		std::vector< std::string > level_names;
+		std::vector< std::unique_ptr< Asset > > level_files; //each level's map file, in level_names order (nullptr if it couldn't be opened)
+		TiltEscape::Level level; //first level, already parsed
+	};
+
+	//load_assets reads the meshes blob and, in parallel, the level files (parsing the first level).
+	//It touches no GL state, so it can run on a worker thread while the window
+	//and GL context are being created; spans are recorded to 'timeline' if given.
+	static Assets load_assets(StartupTimeline *timeline = nullptr);
+
 	//Game creates OpenGL resources (i.e. vertex buffer objects) in its
 	//constructor and frees them in its destructor.
-	Game();
+	Game() : Game(load_assets()) { }
+	explicit Game(Assets &&assets);
 	~Game();
 
+	//(same clock as FrameLimiter's)
+	typedef std::chrono::high_resolution_clock InputClock;
+
 	//handle_event is called when new mouse or keyboard events are received:
 	// (note that this might be many times per frame or never)
 	//The function should return 'true' if it handled the event.
 	bool handle_event(SDL_Event const &evt, glm::uvec2 window_size);
 
-	//update is called at the start of a new frame, after events are handled:
+	//update advances the simulation; it may run on its own thread (see main.cpp),
+	// in which case it only shares 'controls' and 'snapshots' with the other methods:
 	void update(float elapsed);
 
-	//draw is called after update:
+	//draw renders the most recently published snapshot:
 	void draw(glm::uvec2 drawable_size);
 
+	//what the last draw() drew (shown by the performance HUD -- see perf_hud.hpp):
+	struct DrawStats {
+		uint32_t draws = 0;
+		uint32_t triangles = 0;
+		uint32_t guards = 0;
+		uint32_t walls = 0;
+	};
+	DrawStats draw_stats;
+
+	//Snapshot is everything draw needs from the simulation, captured at the end of an update:
+	struct Snapshot {
+		RenderList render_list; //the frame's draws, sorted
+		glm::uvec2 board_size = glm::uvec2(0);
+		uint32_t guards = 0; //(counts for the performance HUD)
+		uint32_t walls = 0;
+		uint64_t serial = 0; //(counts up with each publish)
+		InputClock::rep input_time = 0; //oldest input this snapshot shows that no drawn snapshot has (see drawn_input_time)
+	};
+	//handed from update (writer) to draw (reader) without locking:
+	TripleBuffer< Snapshot > snapshots;
+
+	//when the oldest control change first shown by the last draw() was handled (InputClock::time_point() if none),
+	// for measuring input-to-present latency (see frame_limiter.hpp). Input times go from handle_event
+	// through update into the snapshot that first reflects them, so they stay right when update runs on its
+	// own thread; and each stays on snapshots until draw acknowledges one, so skipped snapshots don't lose it:
+	InputClock::time_point drawn_input_time;
+
+	//fills (and sorts) 'list' from the current game state:
+	void build_render_list(RenderList &list);
+	//captures the current game state as a snapshot for draw; called at the end of update:
+	void publish_snapshot();
+
+	//programs a DrawCommand can use:
+	enum : uint8_t {
+		SimpleShadingProgram = 0,
+	};
+
 	//check if the current game is over
 	bool game_over();
 
@@ -43,30 +111,40 @@ struct Game {
 	// Changes to the the next level
 	void next_level();
 
+	//switches to the level in file 'name' (one of level_names); returns false if there is no such level:
+	bool select_level(std::string const &name);
+
 	// Checks to make sure there are no collisions
 	glm::vec2 check_collision(float next_pos_x, float next_pos_y);
 
 	//------- opengl resources -------
 
+	//compiles (and owns) shader programs, caching linked binaries in dist/shader-cache:
+	ShaderManager shaders;
+
 	//shader program that draws lit objects with vertex colors:
 	struct {
-		GLuint program = -1U; //program object
-
-		//uniform locations:
-		GLuint object_to_clip_mat4 = -1U;
-		GLuint object_to_light_mat4x3 = -1U;
-		GLuint normal_to_light_mat3 = -1U;
-		GLuint sun_direction_vec3 = -1U;
-		GLuint sun_color_vec3 = -1U;
-		GLuint sky_direction_vec3 = -1U;
-		GLuint sky_color_vec3 = -1U;
-
-		//attribute locations:
-		GLuint Position_vec4 = -1U;
-		GLuint Normal_vec3 = -1U;
-		GLuint Color_vec4 = -1U;
+		ShaderManager::Handle handle = -1U;
+		GLuint program = -1U; //program object (-1U until first needed -- see resolve_simple_shading)
+
+		//(no loose uniforms: camera and lighting come from the 'Frame' block -- see frame_uniforms.hpp --
+		// and transforms from the 'Object' block -- see object_uniforms.hpp)
+
+		//attribute locations (fixed by layout qualifiers in the shader):
+		GLuint Position_vec4 = 0;
+		GLuint Normal_vec3 = 1;
+		GLuint Color_vec4 = 2;
 	} simple_shading;
 
+	//waits for simple_shading's program to link, then connects its uniform blocks:
+	void resolve_simple_shading();
+
+	//per-frame data (FrameUniforms), written once per frame in draw():
+	GLuint frame_uniforms_ubo = -1U;
+
+	//per-draw data (ObjectUniforms), streamed every frame in draw():
+	std::unique_ptr< StreamBuffer > object_stream;
+
 	//mesh data, stored in a vertex buffer:
 	GLuint meshes_vbo = -1U; //vertex buffer holding mesh data
 
@@ -75,31 +153,58 @@ struct Game {
 		GLint first = 0;
 		GLsizei count = 0;
 	};
+	//...indexed by MeshHandle (see mesh_index.hpp):
+	std::vector< Mesh > meshes;
 	
 	// Meshes for tilt escape
-	Mesh player_mesh;
-	Mesh guard_mesh;
-	Mesh guard_view_mesh;
-	Mesh wall_mesh;
-	Mesh floor_mesh;
+	MeshHandle player_mesh = InvalidMesh;
+	MeshHandle guard_mesh = InvalidMesh;
+	MeshHandle guard_view_mesh = InvalidMesh;
+	MeshHandle wall_mesh = InvalidMesh;
+	MeshHandle floor_mesh = InvalidMesh;
 
 
 	GLuint meshes_for_simple_shading_vao = -1U; //vertex array object that describes how to connect the meshes_vbo to the simple_shading_program
 
+	//GPU time spent in each draw pass (reported on F2 and when the game is destroyed):
+	GPUProfiler gpu_profiler;
+	//profiler section for draws of 'mesh':
+	char const *pass_name(MeshHandle mesh) const;
+
 	//------- game state -------
 
 	glm::uvec2 board_size = glm::uvec2(5,4);
 	
-	// The guard will have discreet rotations for its FOV
-	std::map<TiltEscape::LookDirection, glm::quat> guard_vision_rotations;
+	// The guard will have discreet rotations for its FOV (indexed by LookDirection)
+	glm::quat guard_vision_rotations[8];
+
+	//controls as bits (for scripted, recorded, and replayed input -- see bench.hpp):
+	enum : uint8_t {
+		TiltLeft = 1,
+		TiltRight = 2,
+		TiltUp = 4,
+		TiltDown = 8,
+	};
+	uint8_t get_controls() const;
+	void set_controls(uint8_t bits);
 
+	//(written by handle_event, read by update -- possibly on different threads)
 	struct {
-		bool tilt_left = false;
-		bool tilt_right = false;
-		bool tilt_up = false;
-		bool tilt_down = false;
+		std::atomic< bool > tilt_left{ false };
+		std::atomic< bool > tilt_right{ false };
+		std::atomic< bool > tilt_up{ false };
+		std::atomic< bool > tilt_down{ false };
 	} controls;
 
+	//input latency bookkeeping (see drawn_input_time), as InputClock time_since_epoch() counts (0 = none):
+	std::atomic< InputClock::rep > unseen_input{ 0 }; //oldest control change update hasn't read (handle_event -> update)
+	InputClock::rep unpublished_input = 0; //oldest change update has read, but no snapshot carries yet (update side)
+	InputClock::rep undrawn_input = 0; //carried by snapshots since 'undrawn_input_serial', until one is drawn (update side)
+	uint64_t undrawn_input_serial = 0;
+	uint64_t published_serial = 0; //(update side)
+	std::atomic< uint64_t > drawn_serial{ 0 }; //newest snapshot draw has read (draw -> update)
+	InputClock::rep last_drawn_input = 0; //(draw side)
+
 	// This is the angle the board is tilted in
 	// either direction
 	const float TILT_ANGLE = 45.0f;
@@ -116,6 +221,9 @@ struct Game {
 	// What levels do we support in the game
 	std::vector<std::string> level_names;
 	int level_index = 0;
+	//each level's map file (nullptr if it couldn't be opened; loaded with the other assets),
+	// kept loaded so restarts and level changes don't touch the disk:
+	std::vector< std::unique_ptr< Asset > > level_files;
 
 	// Reference to the currently loaded level
 	TiltEscape::Level level;
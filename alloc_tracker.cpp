@@ -0,0 +1,147 @@
+#include "alloc_tracker.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <new>
+#include <utility>
+#include <vector>
+
+std::atomic< bool > alloc_tracker_enabled(false);
+thread_local uint32_t alloc_tracker_tag = 0;
+
+void alloc_tracker_enable(bool enable) {
+	alloc_tracker_enabled.store(enable, std::memory_order_relaxed);
+}
+
+AllocTracker &alloc_tracker() {
+	//(constant-initialized and trivially destructible, so it's usable by allocations before main and after exit)
+	static AllocTracker tracker;
+	return tracker;
+}
+
+uint32_t AllocTracker::tag_index(char const *name) {
+	for (uint32_t t = 1; t < MaxTags; ++t) {
+		char const *at = tags[t].name.load(std::memory_order_acquire);
+		if (at == nullptr) {
+			//claim the first free slot (unless another thread just claimed it):
+			if (tags[t].name.compare_exchange_strong(at, name, std::memory_order_acq_rel)) return t;
+		}
+		//(the same literal may have different addresses in different translation units)
+		if (at == name || std::strcmp(at, name) == 0) return t;
+	}
+	return 0;
+}
+
+AllocTracker::Tag const *AllocTracker::find(char const *name) const {
+	for (uint32_t t = 1; t < MaxTags; ++t) {
+		char const *at = tags[t].name.load(std::memory_order_acquire);
+		if (at == nullptr) break;
+		if (std::strcmp(at, name) == 0) return &tags[t];
+	}
+	return nullptr;
+}
+
+void AllocTracker::end_frame() {
+	for (Tag &tag : tags) {
+		uint64_t allocations = tag.frame_allocations.exchange(0, std::memory_order_relaxed);
+		tag.total_allocations += allocations;
+		tag.total_bytes += tag.frame_bytes.exchange(0, std::memory_order_relaxed);
+		tag.max_frame_allocations = std::max(tag.max_frame_allocations, allocations);
+	}
+	++frames;
+}
+
+void AllocTracker::clear() {
+	for (Tag &tag : tags) {
+		tag.frame_allocations.store(0, std::memory_order_relaxed);
+		tag.frame_bytes.store(0, std::memory_order_relaxed);
+		tag.total_allocations = 0;
+		tag.total_bytes = 0;
+		tag.max_frame_allocations = 0;
+	}
+	frames = 0;
+}
+
+void AllocTracker::report(std::ostream &out) const {
+	if (frames == 0) return;
+	double per = 1.0 / double(frames);
+
+	std::vector< std::pair< uint64_t, uint32_t > > used;
+	uint64_t allocations = 0, bytes = 0;
+	for (uint32_t t = 0; t < MaxTags; ++t) {
+		allocations += tags[t].total_allocations;
+		bytes += tags[t].total_bytes;
+		if (tags[t].total_allocations) used.emplace_back(tags[t].total_allocations, t);
+	}
+	out << "Allocations: " << allocations * per << " per frame (" << bytes * per << " bytes), over " << frames << " frames." << std::endl;
+
+	std::sort(used.begin(), used.end(), [](std::pair< uint64_t, uint32_t > const &a, std::pair< uint64_t, uint32_t > const &b) {
+		return a.first > b.first;
+	});
+	for (auto const &u : used) {
+		Tag const &tag = tags[u.second];
+		char const *name = tag.name.load(std::memory_order_acquire);
+		out << "  " << std::left << std::setw(20) << (u.second == 0 || !name ? "untagged" : name) << std::right
+			<< std::fixed << std::setprecision(2)
+			<< std::setw(10) << tag.total_allocations * per << " per frame (at most " << tag.max_frame_allocations << "), "
+			<< std::setw(10) << tag.total_bytes * per << " bytes per frame" << std::endl;
+	}
+	out.unsetf(std::ios::floatfield);
+	out << std::setprecision(6);
+}
+
+//---- the replacement operators ----
+
+static void *allocate(std::size_t size) {
+	if (alloc_tracker_enabled.load(std::memory_order_relaxed)) alloc_tracker().count(alloc_tracker_tag, size);
+	if (size == 0) size = 1;
+	while (true) {
+		void *data = std::malloc(size);
+		if (data) return data;
+		std::new_handler handler = std::get_new_handler();
+		if (!handler) throw std::bad_alloc();
+		handler();
+	}
+}
+
+void *operator new(std::size_t size) {
+	return allocate(size);
+}
+
+void *operator new[](std::size_t size) {
+	return allocate(size);
+}
+
+void *operator new(std::size_t size, std::nothrow_t const &) noexcept {
+	try {
+		return allocate(size);
+	} catch (...) {
+		return nullptr;
+	}
+}
+
+void *operator new[](std::size_t size, std::nothrow_t const &) noexcept {
+	try {
+		return allocate(size);
+	} catch (...) {
+		return nullptr;
+	}
+}
+
+void operator delete(void *data) noexcept {
+	std::free(data);
+}
+
+void operator delete[](void *data) noexcept {
+	std::free(data);
+}
+
+void operator delete(void *data, std::nothrow_t const &) noexcept {
+	std::free(data);
+}
+
+void operator delete[](void *data, std::nothrow_t const &) noexcept {
+	std::free(data);
+}
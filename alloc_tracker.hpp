@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+
+//Allocation tracker: alloc_tracker.cpp replaces the global operator new and
+// operator delete, so every heap allocation the program makes can be counted --
+// per frame, and per tag (the subsystem that made it):
+//   void Game::update(float elapsed) {
+//       ALLOC_TAG("update"); //allocations on this thread count as "update" until the scope ends
+//       ...
+//   }
+//   alloc_tracker_enable(true);          //e.g., for --alloc-stats
+//   ...each frame: alloc_tracker().end_frame();
+//   alloc_tracker().report(std::cout);
+//
+//While tracking is off (the default), an allocation costs one relaxed atomic
+// load on top of malloc, and ALLOC_TAG costs the same. Counters are atomic, so
+// allocations on any thread are counted; an allocation counts toward its thread's
+// innermost tag, or "untagged".
+//
+//Tag names are kept by pointer, so they must be string literals.
+
+//tracking is on while this is true (see alloc_tracker_enable):
+extern std::atomic< bool > alloc_tracker_enabled;
+
+void alloc_tracker_enable(bool enable);
+
+struct AllocTracker {
+	enum { MaxTags = 32 }; //(tags past this count as "untagged")
+
+	struct Tag {
+		std::atomic< char const * > name{ nullptr };
+		//since the last end_frame():
+		std::atomic< uint64_t > frame_allocations{ 0 };
+		std::atomic< uint64_t > frame_bytes{ 0 };
+		//over all finished frames:
+		uint64_t total_allocations = 0;
+		uint64_t total_bytes = 0;
+		uint64_t max_frame_allocations = 0; //most allocations in any finished frame
+	};
+	Tag tags[MaxTags]; //tags[0] is "untagged"; the rest are filled in as tags are first used
+	uint64_t frames = 0;
+
+	//index of the tag called 'name' (adding it if there's room; 0 if not):
+	uint32_t tag_index(char const *name);
+	//the tag called 'name', or nullptr if it was never used:
+	Tag const *find(char const *name) const;
+
+	//counts one allocation (called by operator new):
+	void count(uint32_t tag, uint64_t bytes) {
+		tags[tag].frame_allocations.fetch_add(1, std::memory_order_relaxed);
+		tags[tag].frame_bytes.fetch_add(bytes, std::memory_order_relaxed);
+	}
+
+	//accumulate this frame's counts into the totals and reset them:
+	void end_frame();
+	//forget everything counted so far (e.g., after warm-up frames):
+	void clear();
+
+	//print allocations and bytes per frame for each tag that allocated:
+	void report(std::ostream &out) const;
+};
+
+AllocTracker &alloc_tracker();
+
+//the calling thread's current tag (index into AllocTracker::tags):
+extern thread_local uint32_t alloc_tracker_tag;
+
+//sets the thread's tag for its own lifetime (if tracking was on when it was made):
+struct AllocTagScope {
+	explicit AllocTagScope(char const *name) : previous(alloc_tracker_tag) {
+		if (alloc_tracker_enabled.load(std::memory_order_relaxed)) alloc_tracker_tag = alloc_tracker().tag_index(name);
+	}
+	~AllocTagScope() {
+		alloc_tracker_tag = previous;
+	}
+	AllocTagScope(AllocTagScope const &) = delete;
+	AllocTagScope &operator=(AllocTagScope const &) = delete;
+
+	uint32_t previous;
+};
+
+#define ALLOC_TAG_CONCAT2(A, B) A ## B
+#define ALLOC_TAG_CONCAT(A, B) ALLOC_TAG_CONCAT2(A, B)
+#define ALLOC_TAG(NAME) AllocTagScope ALLOC_TAG_CONCAT(alloc_tag_, __LINE__)(NAME)
@@ -0,0 +1,171 @@
+#include "asset_pack.hpp"
+
+#include "data_path.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+AssetPack::AssetPack(std::string const &filename_) : filename(filename_), file(filename_) {
+	char const *at = file.begin();
+	names = read_chunk(&at, file.end(), "pkn0");
+	entries = read_chunk(&at, file.end(), "pke0", sizeof(Entry));
+	blocks = read_chunk(&at, file.end(), "pkb0", sizeof(Block));
+	data = read_chunk(&at, file.end(), "pkd0");
+	if (at != file.end()) {
+		std::cerr << "WARNING: trailing data in asset pack '" << filename << "'." << std::endl;
+	}
+
+	//the directory is used in place, so it must be aligned:
+	if (reinterpret_cast< uintptr_t >(entries.data) % alignof(Entry) != 0
+	 || reinterpret_cast< uintptr_t >(blocks.data) % alignof(Block) != 0) {
+		throw std::runtime_error("Misaligned directory in asset pack '" + filename + "'.");
+	}
+
+	entry_count = entries.size / sizeof(Entry);
+	uint32_t block_count = blocks.size / sizeof(Block);
+	Entry const *entry = reinterpret_cast< Entry const * >(entries.data);
+	Block const *block = reinterpret_cast< Block const * >(blocks.data);
+
+	for (uint32_t i = 0; i < block_count; ++i) {
+		Block const &b = block[i];
+		if (b.data_begin > b.data_end || b.data_end > data.size) {
+			throw std::runtime_error("invalid data range in asset pack '" + filename + "'.");
+		}
+		if (b.method != Stored && b.method != Deflated) {
+			throw std::runtime_error("unknown compression method in asset pack '" + filename + "'.");
+		}
+		if (b.method == Stored && b.data_end - b.data_begin != b.size) {
+			throw std::runtime_error("invalid stored block size in asset pack '" + filename + "'.");
+		}
+	}
+	for (uint32_t i = 0; i < entry_count; ++i) {
+		Entry const &e = entry[i];
+		if (e.name_begin > e.name_end || e.name_end > names.size) {
+			throw std::runtime_error("invalid name range in asset pack '" + filename + "'.");
+		}
+		if (e.block_begin > e.block_end || e.block_end > block_count) {
+			throw std::runtime_error("invalid block range in asset pack '" + filename + "'.");
+		}
+		uint64_t total = 0;
+		for (uint32_t b = e.block_begin; b < e.block_end; ++b) {
+			total += block[b].size;
+		}
+		if (total != e.size) {
+			throw std::runtime_error("block sizes don't match file size in asset pack '" + filename + "'.");
+		}
+		if (i > 0) {
+			Entry const &p = entry[i-1];
+			std::string prev(names.data + p.name_begin, names.data + p.name_end);
+			std::string name(names.data + e.name_begin, names.data + e.name_end);
+			if (!(prev < name)) {
+				throw std::runtime_error("directory of asset pack '" + filename + "' is not sorted.");
+			}
+		}
+	}
+}
+
+AssetPack::Entry const *AssetPack::find(std::string const &name) const {
+	Entry const *entry = reinterpret_cast< Entry const * >(entries.data);
+	Entry const *found = std::lower_bound(entry, entry + entry_count, name, [this](Entry const &e, std::string const &n) {
+		size_t length = e.name_end - e.name_begin;
+		int c = std::memcmp(names.data + e.name_begin, n.c_str(), std::min(length, n.size()));
+		return c < 0 || (c == 0 && length < n.size());
+	});
+	if (found == entry + entry_count) return nullptr;
+	if (found->name_end - found->name_begin != name.size()) return nullptr;
+	if (std::memcmp(names.data + found->name_begin, name.c_str(), name.size()) != 0) return nullptr;
+	return found;
+}
+
+void AssetPack::read_block(Block const &block, char *dst) const {
+	if (block.method == Stored) {
+		std::memcpy(dst, data.data + block.data_begin, block.size);
+		return;
+	}
+
+	//inflate straight from the mapping into the destination:
+	z_stream stream;
+	std::memset(&stream, 0, sizeof(stream));
+	if (inflateInit(&stream) != Z_OK) {
+		throw std::runtime_error("Failed to initialize zlib.");
+	}
+	stream.next_in = reinterpret_cast< Bytef * >(const_cast< char * >(data.data + block.data_begin));
+	stream.avail_in = block.data_end - block.data_begin;
+	stream.next_out = reinterpret_cast< Bytef * >(dst);
+	stream.avail_out = block.size;
+	int ret = inflate(&stream, Z_FINISH);
+	inflateEnd(&stream);
+	if (ret != Z_STREAM_END || stream.avail_out != 0) {
+		throw std::runtime_error("Corrupt block in asset pack '" + filename + "'.");
+	}
+}
+
+void AssetPack::read(Entry const &entry, char *dst, uint32_t max_threads) const {
+	Block const *block = reinterpret_cast< Block const * >(blocks.data) + entry.block_begin;
+	uint32_t count = entry.block_end - entry.block_begin;
+
+	//where each block lands in dst:
+	std::vector< uint32_t > offsets(count);
+	uint32_t offset = 0;
+	for (uint32_t i = 0; i < count; ++i) {
+		offsets[i] = offset;
+		offset += block[i].size;
+	}
+
+	if (max_threads == 0) max_threads = std::max(1U, std::thread::hardware_concurrency());
+	uint32_t threads = std::min(max_threads, count);
+	if (threads <= 1) {
+		for (uint32_t i = 0; i < count; ++i) {
+			read_block(block[i], dst + offsets[i]);
+		}
+		return;
+	}
+
+	//workers pull blocks off a shared counter until all are inflated:
+	std::atomic< uint32_t > next(0);
+	auto worker = [&]() {
+		for (uint32_t i = next++; i < count; i = next++) {
+			read_block(block[i], dst + offsets[i]);
+		}
+	};
+	std::vector< std::future< void > > workers;
+	for (uint32_t t = 1; t < threads; ++t) {
+		workers.emplace_back(std::async(std::launch::async, worker));
+	}
+	worker();
+	//(get() re-throws any errors from the workers)
+	for (auto &w : workers) {
+		w.get();
+	}
+}
+
+std::unique_ptr< Asset > load_asset(std::string const &name) {
+	//the pack, if the game ships with one, is opened once and shared:
+	static std::unique_ptr< AssetPack > pack = []() -> std::unique_ptr< AssetPack > {
+		std::string path = data_path("assets.pak");
+		if (!std::ifstream(path, std::ios::binary).is_open()) return nullptr;
+		return std::unique_ptr< AssetPack >(new AssetPack(path));
+	}();
+
+	std::unique_ptr< Asset > asset(new Asset);
+	AssetPack::Entry const *entry = (pack ? pack->find(name) : nullptr);
+	if (entry) {
+		asset->inflated.resize(entry->size);
+		if (entry->size) pack->read(*entry, &asset->inflated[0]);
+		asset->begin_ = asset->inflated.data();
+		asset->end_ = asset->begin_ + asset->inflated.size();
+	} else {
+		asset->mapped.reset(new MappedFile(data_path(name)));
+		asset->begin_ = asset->mapped->begin();
+		asset->end_ = asset->mapped->end();
+	}
+	return asset;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "mapped_file.hpp"
+#include "read_chunk.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+//AssetPack reads an archive of compressed asset files (see pack-assets.py).
+//
+//An asset pack is a sequence of chunks (same framing as meshes.blob):
+//  'pkn0' -- file names (chars; padded to a multiple of 4 bytes)
+//  'pke0' -- central directory: one Entry per file, sorted by name
+//  'pkb0' -- blocks: each file is split into blocks (1MB, uncompressed) that are
+//            compressed independently, so they can be inflated in parallel
+//  'pkd0' -- compressed block data
+//
+//The pack is memory-mapped, and blocks are inflated by worker threads straight
+// from the mapping into their place in the destination buffer:
+//   AssetPack pack(data_path("assets.pak"));
+//   AssetPack::Entry const *entry = pack.find("meshes.blob");
+//   std::vector< char > data(entry->size);
+//   pack.read(*entry, data.data());
+
+struct AssetPack {
+	struct Entry {
+		uint32_t name_begin;
+		uint32_t name_end;
+		uint32_t block_begin;
+		uint32_t block_end;
+		uint32_t size; //uncompressed size of the file
+	};
+	static_assert(sizeof(Entry) == 20, "Entry should be packed.");
+
+	struct Block {
+		uint32_t data_begin;
+		uint32_t data_end;
+		uint32_t size; //uncompressed size of the block
+		uint32_t method; //Stored or Deflated
+	};
+	static_assert(sizeof(Block) == 16, "Block should be packed.");
+
+	enum : uint32_t {
+		Stored = 0,
+		Deflated = 1, //zlib stream
+	};
+
+	//maps and validates the pack (throws std::runtime_error on failure):
+	explicit AssetPack(std::string const &filename);
+
+	//returns nullptr if no file by this name is in the pack:
+	Entry const *find(std::string const &name) const;
+
+	//inflate all of entry's blocks into dst (which must hold entry.size bytes),
+	// using up to 'max_threads' worker threads (0 means one per hardware thread):
+	void read(Entry const &entry, char *dst, uint32_t max_threads = 0) const;
+
+	std::string filename;
+
+private:
+	void read_block(Block const &block, char *dst) const;
+
+	MappedFile file;
+	ChunkView names, entries, blocks, data;
+	uint32_t entry_count = 0;
+};
+
+//Asset is the contents of one asset file -- either a loose file mapped in place,
+// or a file inflated out of the asset pack:
+struct Asset {
+	char const *begin() const { return begin_; }
+	char const *end() const { return end_; }
+	size_t size() const { return end_ - begin_; }
+
+	std::unique_ptr< MappedFile > mapped;
+	std::vector< char > inflated;
+	char const *begin_ = nullptr;
+	char const *end_ = nullptr;
+};
+
+//load_asset returns data_path(name), looked up in data_path("assets.pak") when
+// the game ships with a pack, and as a loose file otherwise.
+//(throws std::runtime_error if the asset can't be found or read)
+//Safe to call from multiple threads.
+std::unique_ptr< Asset > load_asset(std::string const &name);
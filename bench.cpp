@@ -0,0 +1,120 @@
+#include "bench.hpp"
+
+#include "Game.hpp"
+#include "read_chunk.hpp"
+#include "sample_stats.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+InputTrack InputTrack::scripted(uint32_t frame_count) {
+	//each step is held for a while, so the ball has time to get going (and hit things):
+	static const uint8_t steps[] = {
+		Game::TiltUp,
+		Game::TiltUp | Game::TiltRight,
+		Game::TiltRight,
+		0,
+		Game::TiltDown | Game::TiltRight,
+		Game::TiltDown,
+		Game::TiltDown | Game::TiltLeft,
+		Game::TiltLeft,
+		0,
+		Game::TiltUp | Game::TiltLeft,
+	};
+	const uint32_t StepFrames = 45;
+	const uint32_t StepCount = sizeof(steps) / sizeof(steps[0]);
+
+	InputTrack track;
+	track.frames.reserve(frame_count);
+	for (uint32_t i = 0; i < frame_count; ++i) {
+		track.frames.emplace_back(steps[(i / StepFrames) % StepCount]);
+	}
+	return track;
+}
+
+InputTrack InputTrack::load(std::string const &filename) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) throw std::runtime_error("Failed to open input recording '" + filename + "'.");
+	InputTrack track;
+	read_chunk(file, "inp0", &track.frames);
+	//(recordings made before levels were saved stop here)
+	if (file.peek() != std::char_traits< char >::eof()) {
+		std::vector< char > level;
+		read_chunk(file, "lvl0", &level);
+		track.level.assign(level.begin(), level.end());
+	}
+	return track;
+}
+
+void InputTrack::save(std::string const &filename) const {
+	std::ofstream file(filename, std::ios::binary);
+	uint32_t size = uint32_t(frames.size());
+	file.write("inp0", 4);
+	file.write(reinterpret_cast< char const * >(&size), 4);
+	file.write(reinterpret_cast< char const * >(frames.data()), size);
+	if (level != "") {
+		uint32_t level_size = uint32_t(level.size());
+		file.write("lvl0", 4);
+		file.write(reinterpret_cast< char const * >(&level_size), 4);
+		file.write(level.data(), level_size);
+	}
+	if (!file) throw std::runtime_error("Failed to write input recording '" + filename + "'.");
+}
+
+void BenchTimings::reserve(size_t frames) {
+	update_ms.reserve(frames);
+	draw_ms.reserve(frames);
+	swap_ms.reserve(frames);
+	frame_ms.reserve(frames);
+}
+
+void BenchTimings::add(float update, float draw, float swap, float frame) {
+	update_ms.emplace_back(update);
+	draw_ms.emplace_back(draw);
+	swap_ms.emplace_back(swap);
+	frame_ms.emplace_back(frame);
+}
+
+void BenchTimings::report(std::ostream &out) const {
+	auto print = [&out](char const *name, std::vector< float > const &samples) {
+		SampleStats stats = summarize(samples);
+		out << "  " << std::left << std::setw(7) << name << std::right << std::fixed << std::setprecision(3)
+			<< " mean " << std::setw(8) << stats.mean
+			<< "  p50 " << std::setw(8) << stats.p50
+			<< "  p95 " << std::setw(8) << stats.p95
+			<< "  p99 " << std::setw(8) << stats.p99
+			<< "  max " << std::setw(8) << stats.max << std::endl;
+	};
+	out << "Frame times (ms, " << frame_ms.size() << " frames):" << std::endl;
+	print("update", update_ms);
+	print("draw", draw_ms);
+	print("swap", swap_ms);
+	print("frame", frame_ms);
+	out.unsetf(std::ios::floatfield);
+	out << std::setprecision(6);
+}
+
+void BenchTimings::report_json(std::ostream &out, std::string const &level, uint32_t frames, uint32_t warmup_frames, std::string const &input) const {
+	//(level and input names are file names, so they are written without escaping)
+	auto print = [&out](char const *name, std::vector< float > const &samples, bool last) {
+		SampleStats stats = summarize(samples);
+		out << "\t\t\"" << name << "\": { "
+			<< "\"mean\": " << stats.mean << ", "
+			<< "\"p50\": " << stats.p50 << ", "
+			<< "\"p95\": " << stats.p95 << ", "
+			<< "\"p99\": " << stats.p99 << ", "
+			<< "\"max\": " << stats.max << " }" << (last ? "" : ",") << "\n";
+	};
+	out << "{\n"
+		<< "\t\"level\": \"" << level << "\",\n"
+		<< "\t\"frames\": " << frames << ",\n"
+		<< "\t\"warmup_frames\": " << warmup_frames << ",\n"
+		<< "\t\"input\": \"" << input << "\",\n"
+		<< "\t\"ms\": {\n";
+	print("update", update_ms, false);
+	print("draw", draw_ms, false);
+	print("swap", swap_ms, false);
+	print("frame", frame_ms, true);
+	out << "\t}\n}" << std::endl;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//Support for '--bench' runs (see main.cpp): deterministic input, and per-frame
+// timings summarized as percentiles.
+
+//each update a track drives advances the game by this many seconds:
+const float InputTrackStep = 1.0f / 60.0f;
+
+//InputTrack holds one byte of control state per update (Game::TiltLeft | ...),
+// so a run can be driven by a script or by input recorded from a real session:
+struct InputTrack {
+	std::vector< uint8_t > frames;
+	std::string level; //level the input was recorded on ("" for scripted input and older recordings)
+
+	//a fixed pattern that tilts the board through every direction (and holds still now and then):
+	static InputTrack scripted(uint32_t frame_count);
+
+	//recordings are an 'inp0' chunk of controls, then a 'lvl0' chunk naming the level; load throws on failure:
+	static InputTrack load(std::string const &filename);
+	void save(std::string const &filename) const;
+
+	//controls for frame 'frame' (tracks loop if a run is longer than they are):
+	uint8_t at(uint32_t frame) const {
+		return frames.empty() ? 0 : frames[frame % frames.size()];
+	}
+};
+
+//BenchTimings collects CPU times (in ms) for each part of each frame:
+struct BenchTimings {
+	std::vector< float > update_ms;
+	std::vector< float > draw_ms; //(includes clearing)
+	std::vector< float > swap_ms; //(includes the frames-in-flight wait)
+	std::vector< float > frame_ms; //whole loop iteration
+
+	void reserve(size_t frames);
+	void add(float update, float draw, float swap, float frame);
+
+	//table of mean/p50/p95/p99/max for each part:
+	void report(std::ostream &out) const;
+	//the same numbers as a JSON object (with the run's settings, for comparing runs):
+	void report_json(std::ostream &out, std::string const &level, uint32_t frames, uint32_t warmup_frames, std::string const &input) const;
+};
@@ -0,0 +1,147 @@
+#include "cpu_profiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic< bool > cpu_profiler_enabled(false);
+
+namespace {
+
+//one thread's recent scopes; written only by that thread:
+struct ThreadRing {
+	//(fields are atomic so the writer can reuse a slot while the ring is being copied)
+	struct Event {
+		std::atomic< char const * > name;
+		std::atomic< uint64_t > begin_ns;
+		std::atomic< uint64_t > end_ns;
+	};
+	Event events[CPUProfilerRingSize];
+	std::atomic< uint64_t > written{0}; //events ever recorded; event i is in events[i % CPUProfilerRingSize]
+
+	uint32_t tid = 0;
+	std::string name; //(guarded by Rings::mutex)
+};
+
+//every thread's ring; rings outlive their threads, so scopes from finished workers still show up:
+struct Rings {
+	std::mutex mutex;
+	std::vector< std::unique_ptr< ThreadRing > > rings;
+};
+Rings &rings() {
+	static Rings *r = new Rings; //(never freed, so threads still running at exit can record)
+	return *r;
+}
+
+//the calling thread's ring, made on first use:
+ThreadRing &thread_ring() {
+	thread_local ThreadRing *ring = nullptr;
+	if (!ring) {
+		Rings &all = rings();
+		std::lock_guard< std::mutex > lock(all.mutex);
+		all.rings.emplace_back(new ThreadRing);
+		ring = all.rings.back().get();
+		ring->tid = uint32_t(all.rings.size());
+		ring->name = "thread " + std::to_string(ring->tid);
+	}
+	return *ring;
+}
+
+}
+
+void cpu_profiler_enable(bool enable) {
+	cpu_profiler_enabled.store(enable, std::memory_order_relaxed);
+}
+
+void cpu_profiler_thread_name(char const *name) {
+	//(threads only get rings while recording, so naming costs nothing otherwise)
+	if (!cpu_profiler_enabled.load(std::memory_order_relaxed)) return;
+	ThreadRing &ring = thread_ring();
+	std::lock_guard< std::mutex > lock(rings().mutex);
+	ring.name = name;
+}
+
+void cpu_profiler_record(char const *name, uint64_t begin_ns, uint64_t end_ns) {
+	ThreadRing &ring = thread_ring();
+	uint64_t index = ring.written.load(std::memory_order_relaxed);
+	//(a reader that sees any of these stores will also see 'written' reach 'index')
+	std::atomic_thread_fence(std::memory_order_release);
+	ThreadRing::Event &event = ring.events[index % CPUProfilerRingSize];
+	event.name.store(name, std::memory_order_relaxed);
+	event.begin_ns.store(begin_ns, std::memory_order_relaxed);
+	event.end_ns.store(end_ns, std::memory_order_relaxed);
+	ring.written.store(index + 1, std::memory_order_release);
+}
+
+bool cpu_profiler_write_trace(std::string const &filename) {
+	struct Event {
+		char const *name;
+		uint64_t begin_ns;
+		uint64_t end_ns;
+	};
+	struct Thread {
+		uint32_t tid;
+		std::string name;
+		std::vector< Event > events;
+	};
+	std::vector< Thread > threads;
+
+	{ //copy every ring:
+		Rings &all = rings();
+		std::lock_guard< std::mutex > lock(all.mutex);
+		threads.reserve(all.rings.size());
+		for (auto const &ring : all.rings) {
+			threads.emplace_back();
+			Thread &thread = threads.back();
+			thread.tid = ring->tid;
+			thread.name = ring->name;
+
+			uint64_t end = ring->written.load(std::memory_order_acquire);
+			uint64_t begin = (end > CPUProfilerRingSize ? end - CPUProfilerRingSize : 0);
+			thread.events.reserve(size_t(end - begin));
+			for (uint64_t i = begin; i < end; ++i) {
+				ThreadRing::Event const &event = ring->events[i % CPUProfilerRingSize];
+				thread.events.emplace_back(Event{
+					event.name.load(std::memory_order_relaxed),
+					event.begin_ns.load(std::memory_order_relaxed),
+					event.end_ns.load(std::memory_order_relaxed)
+				});
+			}
+			//drop the events the owning thread may have overwritten during the copy:
+			std::atomic_thread_fence(std::memory_order_acquire);
+			uint64_t now_written = ring->written.load(std::memory_order_relaxed);
+			if (now_written + 1 > begin + CPUProfilerRingSize) {
+				uint64_t stale = std::min(now_written + 1 - CPUProfilerRingSize - begin, end - begin);
+				thread.events.erase(thread.events.begin(), thread.events.begin() + size_t(stale));
+			}
+		}
+	}
+
+	//times are written relative to the earliest scope:
+	uint64_t origin = ~uint64_t(0);
+	for (auto const &thread : threads) {
+		for (auto const &event : thread.events) origin = std::min(origin, event.begin_ns);
+	}
+
+	std::ofstream out(filename, std::ios::binary);
+	if (!out) return false;
+	out << std::fixed << std::setprecision(3);
+	out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+	bool first = true;
+	for (auto const &thread : threads) {
+		out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << thread.tid
+			<< ", \"args\": {\"name\": \"" << thread.name << "\"}}";
+		first = false;
+		for (auto const &event : thread.events) {
+			//(timestamps are in microseconds)
+			out << ",\n{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << thread.tid
+				<< ", \"ts\": " << (event.begin_ns - origin) / 1000.0
+				<< ", \"dur\": " << (event.end_ns - event.begin_ns) / 1000.0 << "}";
+		}
+	}
+	out << "\n]}\n";
+	return bool(out);
+}
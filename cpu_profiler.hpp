@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+//CPU profiler: PROFILE_SCOPE records how long the rest of the enclosing scope
+// takes, on whichever thread runs it, for viewing as a timeline in
+// chrome://tracing or ui.perfetto.dev:
+//   void Game::update(float elapsed) {
+//       PROFILE_SCOPE("update");
+//       ...
+//   }
+//   cpu_profiler_enable(true);              //e.g., for --profile
+//   cpu_profiler_write_trace("profile.json"); //any time, from any thread
+//
+//While recording is off (the default), a scope costs one relaxed atomic load.
+// While it's on, each thread writes finished scopes to its own ring of the last
+// CPUProfilerRingSize scopes. Only that thread writes to the ring, so no locks are taken;
+// cpu_profiler_write_trace() copies each ring and drops any scope that was
+// overwritten while it was being copied. So writing a trace never stops the
+// threads being profiled.
+//
+//Names are kept by pointer, so they must be string literals.
+
+//recording is on while this is true (see cpu_profiler_enable):
+extern std::atomic< bool > cpu_profiler_enabled;
+
+//scopes kept per thread (the oldest are overwritten first):
+const uint32_t CPUProfilerRingSize = 1 << 16;
+
+void cpu_profiler_enable(bool enable);
+
+//name the calling thread in traces (threads that don't are called "thread N"; ignored while recording is off):
+void cpu_profiler_thread_name(char const *name);
+
+//record a finished scope on the calling thread (times from cpu_profiler_now()):
+void cpu_profiler_record(char const *name, uint64_t begin_ns, uint64_t end_ns);
+
+//write every thread's recorded scopes as Chrome trace event JSON; returns false if the file can't be written:
+bool cpu_profiler_write_trace(std::string const &filename);
+
+inline uint64_t cpu_profiler_now() {
+	return uint64_t(std::chrono::duration_cast< std::chrono::nanoseconds >(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+//records its own lifetime (if recording was on when it was made):
+struct CPUProfileScope {
+	explicit CPUProfileScope(char const *name_) : name(name_), begin(0) {
+		if (cpu_profiler_enabled.load(std::memory_order_relaxed)) begin = cpu_profiler_now();
+	}
+	~CPUProfileScope() {
+		if (begin) cpu_profiler_record(name, begin, cpu_profiler_now());
+	}
+	CPUProfileScope(CPUProfileScope const &) = delete;
+	CPUProfileScope &operator=(CPUProfileScope const &) = delete;
+
+	char const *name;
+	uint64_t begin; //(0 if not recording)
+};
+
+#define PROFILE_SCOPE_CONCAT2(A, B) A ## B
+#define PROFILE_SCOPE_CONCAT(A, B) PROFILE_SCOPE_CONCAT2(A, B)
+#define PROFILE_SCOPE(NAME) CPUProfileScope PROFILE_SCOPE_CONCAT(profile_scope_, __LINE__)(NAME)
@@ -69,5 +69,11 @@ static std::string get_data_path() {
 
 std::string data_path(std::string const &suffix) {
 	static std::string path = get_data_path();
-	return path + "/" + suffix;
+	//(built in place, so each call makes one allocation instead of one per '+')
+	std::string ret;
+	ret.reserve(path.size() + 1 + suffix.size());
+	ret += path;
+	ret += '/';
+	ret += suffix;
+	return ret;
 }
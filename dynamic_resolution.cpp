@@ -0,0 +1,98 @@
+#include "dynamic_resolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+DynamicResolution::DynamicResolution(float target_ms_, float min_scale_, float max_scale_)
+	: target_ms(target_ms_), min_scale(min_scale_), max_scale(std::max(min_scale_, max_scale_)) {
+	scale = std::min(1.0f, max_scale);
+	scale = std::max(scale, min_scale);
+	glGenFramebuffers(1, &framebuffer);
+	glGenRenderbuffers(1, &color_renderbuffer);
+	glGenRenderbuffers(1, &depth_renderbuffer);
+}
+
+DynamicResolution::~DynamicResolution() {
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &color_renderbuffer);
+	glDeleteRenderbuffers(1, &depth_renderbuffer);
+}
+
+void DynamicResolution::allocate(glm::uvec2 size) {
+	glBindRenderbuffer(GL_RENDERBUFFER, color_renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size.x, size.y);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth_renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, size.x, size.y);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_renderbuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth_renderbuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		throw std::runtime_error("DynamicResolution: framebuffer is incomplete.");
+	}
+	allocated_size = size;
+}
+
+glm::uvec2 DynamicResolution::begin_frame(glm::uvec2 drawable_size_) {
+	drawable_size = drawable_size_;
+	glm::uvec2 size(
+		std::max(1U, uint32_t(std::round(drawable_size.x * scale))),
+		std::max(1U, uint32_t(std::round(drawable_size.y * scale)))
+	);
+	if (size != allocated_size) {
+		allocate(size);
+	} else {
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	}
+	glViewport(0, 0, size.x, size.y);
+
+	++frames;
+	scale_sum += scale;
+	return size;
+}
+
+void DynamicResolution::end_frame() {
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(
+		0, 0, allocated_size.x, allocated_size.y,
+		0, 0, drawable_size.x, drawable_size.y,
+		GL_COLOR_BUFFER_BIT, (allocated_size == drawable_size ? GL_NEAREST : GL_LINEAR)
+	);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, drawable_size.x, drawable_size.y);
+}
+
+void DynamicResolution::update(float frame_ms) {
+	if (!(frame_ms > 0.0f)) return;
+	smoothed_ms = (smoothed_ms == 0.0f ? frame_ms : 0.9f * smoothed_ms + 0.1f * frame_ms);
+
+	//wait for the effect of the last change to show up in the (delayed, smoothed) timings:
+	const uint32_t SettleFrames = 16;
+	if (++frames_since_change < SettleFrames) return;
+
+	float next = scale;
+	if (smoothed_ms > target_ms) {
+		//over budget: drop quickly (but not more than 20% at once):
+		next = scale * std::max(0.8f, std::sqrt(target_ms / smoothed_ms));
+	} else if (smoothed_ms < 0.8f * target_ms) {
+		//comfortably under budget: creep back up, aiming a bit under target:
+		next = scale * std::min(1.05f, std::sqrt(0.9f * target_ms / smoothed_ms));
+	}
+	next = std::round(next * 20.0f) / 20.0f;
+	next = std::min(max_scale, std::max(min_scale, next));
+
+	if (next != scale) {
+		scale = next;
+		frames_since_change = 0;
+		++changes;
+	}
+}
+
+void DynamicResolution::report(std::ostream &out) const {
+	if (frames == 0) return;
+	out << "Dynamic resolution: target " << target_ms << "ms, scale " << min_scale << "-" << max_scale
+		<< "; average scale " << scale_sum / frames << ", final " << scale << " (" << changes << " changes)." << std::endl;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <iostream>
+
+//DynamicResolution renders the scene into an offscreen framebuffer at a
+// fraction ('scale') of the drawable size and upscales it to the window, with
+// the scale adjusted to hold a target frame time:
+//   glm::uvec2 render_size = dynamic_resolution.begin_frame(drawable_size);
+//   ...clear, draw at render_size...
+//   dynamic_resolution.end_frame(); //blit (bilinear) to the default framebuffer
+//   dynamic_resolution.update(gpu_frame_ms);
+//
+//The controller smooths the measured times and only steps the scale every few
+// frames (timings arrive late, so reacting every frame would oscillate). Since
+// cost scales with pixel count -- scale squared -- steps are sized by the square
+// root of the time ratio. Scales are quantized to 1/20ths, so the render target
+// is only reallocated when the scale actually changes.
+struct DynamicResolution {
+	DynamicResolution(float target_ms, float min_scale, float max_scale);
+	~DynamicResolution();
+
+	DynamicResolution(DynamicResolution const &) = delete;
+	DynamicResolution &operator=(DynamicResolution const &) = delete;
+
+	//binds the offscreen framebuffer (sized for the current scale) and sets the viewport; returns its size:
+	glm::uvec2 begin_frame(glm::uvec2 drawable_size);
+	//upscales to the default framebuffer (and leaves it bound):
+	void end_frame();
+	//feed back how long a frame took (ignored if zero, e.g. while timings aren't available yet):
+	void update(float frame_ms);
+
+	float target_ms;
+	float min_scale;
+	float max_scale;
+	float scale = 1.0f;
+
+	void report(std::ostream &out) const;
+
+private:
+	void allocate(glm::uvec2 size);
+
+	GLuint framebuffer = 0;
+	GLuint color_renderbuffer = 0;
+	GLuint depth_renderbuffer = 0;
+	glm::uvec2 allocated_size = glm::uvec2(0);
+	glm::uvec2 drawable_size = glm::uvec2(0);
+
+	float smoothed_ms = 0.0f;
+	uint32_t frames_since_change = 0;
+
+	//for report():
+	uint64_t frames = 0;
+	double scale_sum = 0.0;
+	uint32_t changes = 0;
+};
@@ -0,0 +1,193 @@
+#include "frame_capture.hpp"
+
+#include "gl_state.hpp"
+#include "png_io.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+FrameCapture::FrameCapture(std::string const &path_, Format format_, uint32_t fps_) : path(path_), format(format_), fps(fps_) {
+	if (format == Y4M) {
+		y4m.open(path, std::ios::binary);
+		if (!y4m) throw std::runtime_error("FrameCapture: failed to open '" + path + "' for writing.");
+	}
+	for (Slot &slot : slots) {
+		glGenBuffers(1, &slot.pbo);
+	}
+	worker = std::thread([this]() { work(); });
+}
+
+FrameCapture::~FrameCapture() {
+	//hand over everything still in flight (blocking -- this is shutdown):
+	for (uint32_t i = 0; i < Slots; ++i) {
+		Slot &slot = slots[(next_slot + i) % Slots];
+		if (slot.state != Slot::Reading) continue;
+		glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(-1));
+		glDeleteSync(slot.fence);
+		slot.fence = 0;
+		gl_state().bind_buffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+		void const *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.size.x * slot.size.y * 4, GL_MAP_READ_BIT);
+		if (!pixels) continue;
+		slot.state = Slot::Mapped;
+		std::lock_guard< std::mutex > lock(mutex);
+		jobs.emplace_back(Job{ &slot, pixels, slot.size, slot.frame });
+		++frames_captured;
+	}
+	cv.notify_one();
+
+	{
+		std::lock_guard< std::mutex > lock(mutex);
+		quit = true;
+	}
+	cv.notify_one();
+	worker.join();
+
+	for (Slot &slot : slots) {
+		if (slot.state == Slot::Mapped || slot.state == Slot::Released) {
+			gl_state().bind_buffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		if (slot.fence) glDeleteSync(slot.fence);
+		glDeleteBuffers(1, &slot.pbo);
+	}
+	gl_state().bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	if (y4m_skipped) {
+		std::cerr << "WARNING: " << y4m_skipped << " captured frames were skipped because the window size changed during Y4M capture." << std::endl;
+	}
+}
+
+void FrameCapture::capture(glm::uvec2 size) {
+	//(1) unmap buffers the worker has finished copying out of:
+	for (Slot &slot : slots) {
+		if (slot.state == Slot::Released) {
+			gl_state().bind_buffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			slot.state = Slot::Free;
+		}
+	}
+
+	//(2) hand finished readbacks (oldest first) to the worker:
+	bool handed = false;
+	for (uint32_t i = 0; i < Slots; ++i) {
+		Slot &slot = slots[(next_slot + i) % Slots];
+		if (slot.state != Slot::Reading) continue;
+		//(timeout of zero: never wait here)
+		GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) break;
+		glDeleteSync(slot.fence);
+		slot.fence = 0;
+		gl_state().bind_buffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+		void const *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.size.x * slot.size.y * 4, GL_MAP_READ_BIT);
+		if (!pixels) {
+			slot.state = Slot::Free;
+			++frames_dropped;
+			continue;
+		}
+		slot.state = Slot::Mapped;
+		{
+			std::lock_guard< std::mutex > lock(mutex);
+			jobs.emplace_back(Job{ &slot, pixels, slot.size, slot.frame });
+		}
+		++frames_captured;
+		handed = true;
+	}
+	if (handed) cv.notify_one();
+
+	//(3) start reading back this frame, if there is a free buffer:
+	uint64_t frame = frame_counter++;
+	Slot &slot = slots[next_slot];
+	if (slot.state != Slot::Free) {
+		++frames_dropped;
+		return;
+	}
+	next_slot = (next_slot + 1) % Slots;
+
+	gl_state().bind_buffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+	if (slot.size != size) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, size.x * size.y * 4, nullptr, GL_STREAM_READ);
+		slot.size = size;
+	}
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	//(with a pack buffer bound, this only queues a copy into the buffer -- it doesn't wait for it)
+	glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	gl_state().bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.frame = frame;
+	slot.state = Slot::Reading;
+}
+
+void FrameCapture::work() {
+	std::vector< Job > batch;
+	std::vector< std::vector< uint8_t > > copies;
+	while (true) {
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			cv.wait(lock, [this]() { return quit || !jobs.empty(); });
+			if (jobs.empty() && quit) break;
+			batch.assign(jobs.begin(), jobs.end());
+			jobs.clear();
+		}
+		//copy everything out first, so the render thread gets its buffers back quickly:
+		if (copies.size() < batch.size()) copies.resize(batch.size());
+		for (size_t i = 0; i < batch.size(); ++i) {
+			Job const &job = batch[i];
+			copies[i].resize(size_t(job.size.x) * job.size.y * 4);
+			std::memcpy(copies[i].data(), job.pixels, copies[i].size());
+			job.slot->state = Slot::Released;
+		}
+		//...then do the slow part:
+		for (size_t i = 0; i < batch.size(); ++i) {
+			try {
+				write_frame(copies[i], batch[i].size, batch[i].frame);
+			} catch (std::exception &e) {
+				std::cerr << "WARNING: frame capture: " << e.what() << std::endl;
+			}
+		}
+	}
+}
+
+void FrameCapture::write_frame(std::vector< uint8_t > const &rgba, glm::uvec2 size, uint64_t frame) {
+	if (format == PNG) {
+		char number[24];
+		std::snprintf(number, sizeof(number), "%06llu", (unsigned long long)frame);
+		save_png(path + number + ".png", size.x, size.y, rgba.data(), true);
+		return;
+	}
+
+	//Y4M: the first frame fixes the video size:
+	if (y4m_size == glm::uvec2(0)) {
+		y4m_size = size;
+		y4m << "YUV4MPEG2 W" << size.x << " H" << size.y << " F" << fps << ":1 Ip A1:1 C444\n";
+	}
+	if (size != y4m_size) {
+		++y4m_skipped;
+		return;
+	}
+
+	//BT.601 studio-swing RGB -> YCbCr, flipped so the first row is the top of the image:
+	size_t count = size_t(size.x) * size.y;
+	planes.resize(count * 3);
+	uint8_t *Y = planes.data();
+	uint8_t *U = Y + count;
+	uint8_t *V = U + count;
+	for (uint32_t y = 0; y < size.y; ++y) {
+		uint8_t const *src = rgba.data() + size_t(size.y - 1 - y) * size.x * 4;
+		size_t row = size_t(y) * size.x;
+		for (uint32_t x = 0; x < size.x; ++x) {
+			int r = src[4*x+0], g = src[4*x+1], b = src[4*x+2];
+			Y[row + x] = uint8_t((( 66 * r + 129 * g +  25 * b + 128) >> 8) + 16);
+			U[row + x] = uint8_t(((-38 * r -  74 * g + 112 * b + 128) >> 8) + 128);
+			V[row + x] = uint8_t(((112 * r -  94 * g -  18 * b + 128) >> 8) + 128);
+		}
+	}
+	y4m << "FRAME\n";
+	y4m.write(reinterpret_cast< char const * >(planes.data()), planes.size());
+	if (!y4m) throw std::runtime_error("failed to write to '" + path + "'.");
+}
+
+void FrameCapture::report(std::ostream &out) const {
+	out << "Captured " << frames_captured << " frames to '" << path << "' (" << (format == PNG ? "png" : "y4m")
+		<< "); dropped " << frames_dropped << "." << std::endl;
+}
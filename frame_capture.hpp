@@ -0,0 +1,91 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//FrameCapture records what is drawn to the default framebuffer, as a sequence
+// of PNGs or as a single raw Y4M video, without stalling the render thread:
+//   FrameCapture capture("frames/", FrameCapture::PNG);
+//   ...draw...; capture.capture(drawable_size); swap...
+//
+//capture() only issues a glReadPixels into one of a ring of pixel buffer
+// objects and fences it. A few frames later (once the fence has passed, so the
+// copy is done) the buffer is mapped and handed to a worker thread, which copies
+// the pixels out -- releasing the buffer -- and then does the encoding and file
+// writing. If every buffer is still busy, the frame is dropped (and counted)
+// rather than waited for.
+struct FrameCapture {
+	enum Format {
+		PNG, //<prefix>000000.png, <prefix>000001.png, ...
+		Y4M, //one .y4m file (4:4:4, so no chroma subsampling artifacts on thin lines)
+	};
+
+	FrameCapture(std::string const &path, Format format, uint32_t fps = 60);
+	~FrameCapture(); //finishes writing queued frames
+
+	FrameCapture(FrameCapture const &) = delete;
+	FrameCapture &operator=(FrameCapture const &) = delete;
+
+	//call after drawing, before swapping; reads the back buffer (of size 'size'):
+	void capture(glm::uvec2 size);
+
+	uint64_t frames_captured = 0; //frames handed to the worker
+	uint64_t frames_dropped = 0; //frames skipped because no buffer was free
+	void report(std::ostream &out) const;
+
+private:
+	enum { Slots = 4 };
+	struct Slot {
+		GLuint pbo = 0;
+		glm::uvec2 size = glm::uvec2(0);
+		GLsync fence = 0;
+		uint64_t frame = 0;
+		enum State : uint32_t {
+			Free, //ready for a new readback
+			Reading, //glReadPixels issued, waiting on 'fence'
+			Mapped, //mapped and handed to the worker
+			Released, //worker is done with the mapping (render thread unmaps it)
+		};
+		std::atomic< uint32_t > state{ Free };
+	};
+	Slot slots[Slots];
+	uint32_t next_slot = 0;
+	uint64_t frame_counter = 0;
+
+	std::string path;
+	Format format;
+	uint32_t fps;
+
+	//---- worker ----
+	struct Job {
+		Slot *slot;
+		void const *pixels; //(mapped memory, valid until slot is Released)
+		glm::uvec2 size;
+		uint64_t frame;
+	};
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::deque< Job > jobs;
+	bool quit = false;
+	std::thread worker;
+	void work();
+
+	//worker-side output state:
+	std::ofstream y4m;
+	glm::uvec2 y4m_size = glm::uvec2(0);
+	uint64_t y4m_skipped = 0; //frames that didn't match the video's size
+	std::vector< uint8_t > planes; //Y, U, V scratch
+	void write_frame(std::vector< uint8_t > const &rgba, glm::uvec2 size, uint64_t frame);
+};
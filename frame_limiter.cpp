@@ -0,0 +1,83 @@
+#include "frame_limiter.hpp"
+
+#include "sample_stats.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+
+FrameLimiter::FrameLimiter(uint32_t max_frames_in_flight_) : max_frames_in_flight(std::min< uint32_t >(max_frames_in_flight_, MaxFramesInFlight)) {
+}
+
+FrameLimiter::~FrameLimiter() {
+	while (pending_count) {
+		glDeleteSync(pending[pending_begin].fence);
+		pending_begin = (pending_begin + 1) % (MaxFramesInFlight + 1);
+		--pending_count;
+	}
+}
+
+bool FrameLimiter::retire_oldest(bool wait) {
+	Pending &oldest = pending[pending_begin];
+	GLenum result = glClientWaitSync(oldest.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	if (result == GL_TIMEOUT_EXPIRED) {
+		if (!wait) return false;
+		++waits;
+		Clock::time_point before = Clock::now();
+		do {
+			result = glClientWaitSync(oldest.fence, 0, 1000000); //1ms
+		} while (result == GL_TIMEOUT_EXPIRED);
+		wait_ms += std::chrono::duration< double, std::milli >(Clock::now() - before).count();
+	}
+
+	if (oldest.input_time != Clock::time_point()) {
+		latency_ms[latency_next] = std::chrono::duration< float, std::milli >(Clock::now() - oldest.input_time).count();
+		latency_next = (latency_next + 1) % HistorySize;
+		if (latency_count < HistorySize) ++latency_count;
+	}
+
+	glDeleteSync(oldest.fence);
+	pending_begin = (pending_begin + 1) % (MaxFramesInFlight + 1);
+	--pending_count;
+	return true;
+}
+
+void FrameLimiter::frame_submitted(Clock::time_point input_time) {
+	++frames;
+
+	//(with no limit, the queue holds just enough frames to measure latency)
+	uint32_t limit = (max_frames_in_flight ? max_frames_in_flight : MaxFramesInFlight);
+
+	//make room, then fence this frame:
+	while (pending_count >= MaxFramesInFlight) retire_oldest(true);
+	Pending &p = pending[(pending_begin + pending_count) % (MaxFramesInFlight + 1)];
+	p.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	p.input_time = input_time;
+	++pending_count;
+
+	//retire whatever has finished; wait only if too many frames are still in flight:
+	while (pending_count > 0) {
+		bool must_wait = (max_frames_in_flight != 0 && pending_count >= limit);
+		if (!retire_oldest(must_wait)) break;
+	}
+}
+
+void FrameLimiter::report(std::ostream &out) const {
+	if (frames == 0) return;
+	out << "Frames in flight: ";
+	if (max_frames_in_flight) out << "at most " << max_frames_in_flight;
+	else out << "unlimited";
+	out << "; " << waits << " of " << frames << " frames waited (" << std::fixed << std::setprecision(2) << wait_ms << "ms total)." << std::endl;
+	if (latency_count) {
+		SampleStats stats = summarize(std::vector< float >(latency_ms, latency_ms + latency_count));
+		out << "Input-to-present latency (ms):"
+			<< " mean " << stats.mean
+			<< "  p50 " << stats.p50
+			<< "  p95 " << stats.p95
+			<< "  p99 " << stats.p99
+			<< "  max " << stats.max
+			<< "  (" << stats.count << " inputs)" << std::endl;
+	}
+	out.unsetf(std::ios::floatfield);
+	out << std::setprecision(6);
+}
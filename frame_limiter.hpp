@@ -0,0 +1,65 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+//FrameLimiter caps how many frames the driver may queue ahead of the GPU.
+//Call frame_submitted() right after each swap: it fences the frame, then waits
+// until fewer than max_frames_in_flight frames are still being processed.
+//Sampling input *after* that wait keeps input from sitting in a deep queue:
+//   SDL_GL_SwapWindow(window);
+//   limiter.frame_submitted(game->drawn_input_time);
+//   ...poll events, update, draw...
+//
+//It also measures input-to-present latency: from when an input event was
+// handled to when the GPU finished the first frame that shows its effect --
+// i.e., that draws a snapshot published by an update that read it, which with
+// update on its own thread can be a tick or more after the event (see
+// Game::drawn_input_time). Completion is observed when that frame's fence is
+// waited on or polled, so the measurement is never an underestimate.
+struct FrameLimiter {
+	typedef std::chrono::high_resolution_clock Clock;
+	enum {
+		MaxFramesInFlight = 8,
+		HistorySize = 512,
+	};
+
+	//0 means unlimited (just measure latency):
+	explicit FrameLimiter(uint32_t max_frames_in_flight);
+	~FrameLimiter();
+
+	FrameLimiter(FrameLimiter const &) = delete;
+	FrameLimiter &operator=(FrameLimiter const &) = delete;
+
+	//'input_time' is when the oldest input event this frame is the first to show was handled
+	// (Clock::time_point() if there was none):
+	void frame_submitted(Clock::time_point input_time);
+
+	uint32_t max_frames_in_flight;
+
+	uint64_t frames = 0;
+	uint64_t waits = 0; //frames that had to wait for an older frame to finish
+	double wait_ms = 0.0;
+
+	//print waits and input-to-present latency percentiles:
+	void report(std::ostream &out) const;
+
+private:
+	struct Pending {
+		GLsync fence;
+		Clock::time_point input_time;
+	};
+	Pending pending[MaxFramesInFlight + 1];
+	uint32_t pending_begin = 0;
+	uint32_t pending_count = 0;
+
+	//retire the oldest pending frame, blocking if 'wait' (otherwise only if already done); returns true if retired:
+	bool retire_oldest(bool wait);
+
+	float latency_ms[HistorySize];
+	uint32_t latency_count = 0;
+	uint32_t latency_next = 0;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+//FrameUniforms holds the data that is constant over a frame (camera + lighting).
+//It lives in a single uniform buffer that is written once per frame and shared
+// by every program that declares FRAME_UNIFORMS_GLSL.
+
+//matches the std140 layout of the GLSL block below:
+struct FrameUniforms {
+	glm::mat4 world_to_clip;
+	glm::vec4 sun_direction; //(w unused)
+	glm::vec4 sun_color; //(w unused)
+	glm::vec4 sky_direction; //(w unused)
+	glm::vec4 sky_color; //(w unused)
+};
+static_assert(sizeof(FrameUniforms) == 64 + 4 * 16, "FrameUniforms should match std140 layout.");
+
+#define FRAME_UNIFORMS_GLSL \
+	"layout(std140) uniform Frame {\n" \
+	"	mat4 world_to_clip;\n" \
+	"	vec4 sun_direction;\n" \
+	"	vec4 sun_color;\n" \
+	"	vec4 sky_direction;\n" \
+	"	vec4 sky_color;\n" \
+	"};\n"
+
+//uniform buffer binding point the frame uniform buffer is bound to:
+const GLuint FrameUniformsBinding = 0;
+
+//point a program's 'Frame' block (if it uses one) at FrameUniformsBinding:
+inline void bind_frame_uniforms(GLuint program) {
+	GLuint index = glGetUniformBlockIndex(program, "Frame");
+	if (index != GL_INVALID_INDEX) {
+		glUniformBlockBinding(program, index, FrameUniformsBinding);
+	}
+}
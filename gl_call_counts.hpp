@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+//GLCallCounts holds what both GL call counters -- the mock (gl_mock.hpp) and the
+// instrumented build's wrappers (gl_instrument.hpp) -- count, and prints it the same
+// way, so a mock build's report and an instrumented build's can be compared:
+//   struct Counters : GLCallCounts< FunctionCount > { ...anything else... };
+//   ++frame.calls[function]; frame.count_bytes(size, target == GL_UNIFORM_BUFFER);
+//   total.add(frame); //(in end_frame)
+//   total.print_per_frame(out, per); total.print_calls(out, name, per);
+template< uint32_t FunctionCount >
+struct GLCallCounts {
+	uint64_t calls[FunctionCount] = {}; //per entry point
+	uint64_t draws = 0;
+	uint64_t vertices = 0; //(from glDrawArrays)
+	//data passed to glBufferData/glBufferSubData, plus the length of every write mapping:
+	uint64_t buffer_bytes = 0;
+	uint64_t uniform_bytes = 0; //(the part of buffer_bytes bound for GL_UNIFORM_BUFFER)
+
+	void count_bytes(uint64_t bytes, bool uniform) {
+		buffer_bytes += bytes;
+		if (uniform) uniform_bytes += bytes;
+	}
+
+	uint64_t total_calls() const {
+		uint64_t sum = 0;
+		for (uint64_t c : calls) sum += c;
+		return sum;
+	}
+
+	void add(GLCallCounts const &other) {
+		for (uint32_t f = 0; f < FunctionCount; ++f) {
+			calls[f] += other.calls[f];
+		}
+		draws += other.draws;
+		vertices += other.vertices;
+		buffer_bytes += other.buffer_bytes;
+		uniform_bytes += other.uniform_bytes;
+	}
+
+	//"C calls (D draws of V vertices), B buffer bytes (U uniform)", scaled by 'per' (e.g., 1 / frames):
+	void print_per_frame(std::ostream &out, double per) const {
+		out << total_calls() * per << " calls (" << draws * per << " draws of " << vertices * per << " vertices), "
+			<< buffer_bytes * per << " buffer bytes (" << uniform_bytes * per << " uniform)";
+	}
+
+	//calls per frame for each entry point used, most first (only the first 'limit', if not 0):
+	void print_calls(std::ostream &out, char const *(*name)(uint32_t function), double per, size_t limit = 0) const {
+		std::vector< std::pair< uint64_t, uint32_t > > used;
+		for (uint32_t f = 0; f < FunctionCount; ++f) {
+			if (calls[f]) used.emplace_back(calls[f], f);
+		}
+		std::sort(used.begin(), used.end(), [](std::pair< uint64_t, uint32_t > const &a, std::pair< uint64_t, uint32_t > const &b) {
+			return a.first > b.first;
+		});
+		if (limit != 0 && used.size() > limit) used.resize(limit);
+		for (auto const &u : used) {
+			out << "  " << std::left << std::setw(28) << name(u.second) << std::right << std::fixed << std::setprecision(2)
+				<< std::setw(10) << u.first * per << " per frame" << std::endl;
+		}
+		out.unsetf(std::ios::floatfield);
+		out << std::setprecision(6);
+	}
+};
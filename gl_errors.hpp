@@ -1,13 +1,23 @@
 #pragma once
 
 #include "GL.hpp"
+#include <SDL.h>
 #include <iostream>
 #include <string>
 
 #define STR2(X) # X
 #define STR(X) STR2(X)
 
+//gl_debug_output_active is true once install_gl_debug_callback has succeeded:
+inline bool &gl_debug_output_active() {
+	static bool active = false;
+	return active;
+}
+
 inline void gl_errors(std::string const &where) {
+	//the debug callback already reports errors as they happen, without a round trip to the driver:
+	if (gl_debug_output_active()) return;
+
 	GLenum err = 0;
 	while ((err = glGetError()) != GL_NO_ERROR) {
 		#define CHECK( ERR ) \
@@ -28,5 +38,82 @@ inline void gl_errors(std::string const &where) {
 		#undef CHECK
 	}
 }
+
+//GL_ERRORS() polls glGetError in debug builds, and compiles to nothing in release (NDEBUG) builds:
+#ifdef NDEBUG
+#define GL_ERRORS() do { } while (0)
+#else
 #define GL_ERRORS() gl_errors(__FILE__  ":" STR(__LINE__) )
+#endif
+
+//---- KHR_debug output ----
+
+inline char const *gl_debug_source_name(GLenum source) {
+	switch (source) {
+		case GL_DEBUG_SOURCE_API: return "api";
+		case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "window system";
+		case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+		case GL_DEBUG_SOURCE_THIRD_PARTY: return "third party";
+		case GL_DEBUG_SOURCE_APPLICATION: return "application";
+		default: return "other";
+	}
+}
+
+inline char const *gl_debug_type_name(GLenum type) {
+	switch (type) {
+		case GL_DEBUG_TYPE_ERROR: return "error";
+		case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated behavior";
+		case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "undefined behavior";
+		case GL_DEBUG_TYPE_PORTABILITY: return "portability";
+		case GL_DEBUG_TYPE_PERFORMANCE: return "performance";
+		case GL_DEBUG_TYPE_MARKER: return "marker";
+		default: return "other";
+	}
+}
 
+inline char const *gl_debug_severity_name(GLenum severity) {
+	switch (severity) {
+		case GL_DEBUG_SEVERITY_HIGH: return "high";
+		case GL_DEBUG_SEVERITY_MEDIUM: return "medium";
+		case GL_DEBUG_SEVERITY_LOW: return "low";
+		default: return "notification";
+	}
+}
+
+inline void APIENTRY gl_debug_message(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, GLchar const *message, void const *user_param) {
+	std::cerr << (type == GL_DEBUG_TYPE_ERROR ? "WARNING: gl error" : "NOTE: gl message")
+		<< " [" << gl_debug_type_name(type) << ", " << gl_debug_severity_name(severity)
+		<< ", from " << gl_debug_source_name(source) << ", id " << id << "]: "
+		<< std::string(message, length < 0 ? std::char_traits< char >::length(message) : size_t(length)) << std::endl;
+}
+
+//install_gl_debug_callback has the driver report errors, performance warnings,
+// etc. through a KHR_debug message callback (requires a debug context).
+//Once installed, GL_ERRORS() no longer needs to poll glGetError.
+//'synchronous' makes messages arrive inside the offending call (useful in a
+// debugger, but slower). Returns false if KHR_debug isn't available.
+inline bool install_gl_debug_callback(bool synchronous = false) {
+	typedef void (APIENTRYP DebugMessageCallbackProc) (GLDEBUGPROC callback, const void *userParam);
+	typedef void (APIENTRYP DebugMessageControlProc) (GLenum source, GLenum type, GLenum severity, GLsizei count, const GLuint *ids, GLboolean enabled);
+
+	if (!SDL_GL_ExtensionSupported("GL_KHR_debug")) return false;
+	GLint flags = 0;
+	glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+	if (!(flags & GL_CONTEXT_FLAG_DEBUG_BIT)) return false;
+
+	DebugMessageCallbackProc debug_message_callback = (DebugMessageCallbackProc)SDL_GL_GetProcAddress("glDebugMessageCallback");
+	DebugMessageControlProc debug_message_control = (DebugMessageControlProc)SDL_GL_GetProcAddress("glDebugMessageControl");
+	if (!debug_message_callback || !debug_message_control) return false;
+
+	debug_message_callback(gl_debug_message, nullptr);
+	//only report things worth acting on:
+	debug_message_control(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+	glEnable(GL_DEBUG_OUTPUT);
+	if (synchronous) glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+	else glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+
+	//anything that happened before the callback was installed still needs to be polled once:
+	gl_errors("before debug callback");
+	gl_debug_output_active() = true;
+	return true;
+}
@@ -0,0 +1,220 @@
+//(the wrappers below are installed over the entry points, so tracing mustn't rename them)
+#define GL_TRACE_NO_REDIRECT
+
+#ifdef GL_INSTRUMENT
+
+#include "gl_instrument.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+GLInstrument &gl_instrument() {
+	static GLInstrument instrument;
+	return instrument;
+}
+
+char const *GLInstrument::name(uint32_t function) {
+	static char const *names[GLFunctionCount] = {
+		#undef GL_SHIMS_HPP
+		#define DO(TYPE, NAME) "gl" #NAME,
+		#include "gl_shims.hpp"
+		#undef DO
+	};
+	return (function < GLFunctionCount ? names[function] : "?");
+}
+
+GLInstrument::Summary GLInstrument::summarize(Counters const &counters) const {
+	Summary summary;
+	for (uint32_t f = 0; f < GLFunctionCount; ++f) {
+		uint64_t calls = counters.calls[f];
+		summary.calls += calls;
+		if (kind[f] == Uniform) summary.uniform_calls += calls;
+		else if (kind[f] == State) summary.state_changes += calls;
+		else if (kind[f] == Query) summary.queries += calls;
+		summary.timed_ms += counters.ms[f];
+	}
+	summary.draws = counters.draws;
+	summary.buffer_bytes = counters.buffer_bytes;
+	summary.uniform_bytes = counters.uniform_bytes;
+	return summary;
+}
+
+void GLInstrument::end_frame() {
+	total.add(frame);
+	for (uint32_t f = 0; f < GLFunctionCount; ++f) {
+		total.ms[f] += frame.ms[f];
+	}
+	last = summarize(frame);
+	++frames;
+	frame = Counters();
+}
+
+void GLInstrument::report(std::ostream &out) const {
+	if (frames == 0) return;
+	double per = 1.0 / double(frames);
+	Summary sum = summarize(total);
+	out << "GL per frame: ";
+	total.print_per_frame(out, per);
+	out << "; " << sum.state_changes * per << " state changes, " << sum.uniform_calls * per << " glUniform* calls, "
+		<< sum.queries * per << " queries, " << sum.timed_ms * per << "ms in timed calls; over "
+		<< frames << " frames." << std::endl;
+
+	std::vector< std::pair< double, uint32_t > > by_time;
+	for (uint32_t f = 0; f < GLFunctionCount; ++f) {
+		if (total.ms[f] > 0.0) by_time.emplace_back(total.ms[f], f);
+	}
+	std::sort(by_time.begin(), by_time.end(), [](std::pair< double, uint32_t > const &a, std::pair< double, uint32_t > const &b) {
+		return a.first > b.first;
+	});
+	if (by_time.size() > 10) by_time.resize(10);
+	out << "Most time:" << std::endl;
+	for (auto const &entry : by_time) {
+		out << "  " << std::left << std::setw(28) << name(entry.second) << std::right << std::fixed << std::setprecision(3)
+			<< std::setw(10) << entry.first * per << "ms per frame" << std::endl;
+	}
+	out.unsetf(std::ios::floatfield);
+	out << std::setprecision(6);
+
+	out << "Most calls:" << std::endl;
+	total.print_calls(out, &GLInstrument::name, per, 10);
+}
+
+//---- wrappers ----
+
+namespace {
+
+//adds the time from construction to destruction to 'ms':
+struct CallTimer {
+	typedef std::chrono::high_resolution_clock Clock;
+	explicit CallTimer(double &ms_) : ms(ms_), start(Clock::now()) { }
+	~CallTimer() {
+		ms += std::chrono::duration< double, std::milli >(Clock::now() - start).count();
+	}
+	double &ms;
+	Clock::time_point start;
+};
+
+//entry points whose arguments feed the byte/vertex counts get an Observe specialization:
+template< uint32_t F >
+struct Observe {
+	template< typename... Args >
+	static void call(GLInstrument::Counters &, Args...) { }
+};
+
+void count_bytes(GLInstrument::Counters &counters, GLenum target, GLsizeiptr size) {
+	counters.count_bytes(uint64_t(size), target == GL_UNIFORM_BUFFER);
+}
+
+template< >
+struct Observe< GLFunction_BufferData > {
+	static void call(GLInstrument::Counters &counters, GLenum target, GLsizeiptr size, const void *data, GLenum) {
+		if (data) count_bytes(counters, target, size);
+	}
+};
+
+template< >
+struct Observe< GLFunction_BufferSubData > {
+	static void call(GLInstrument::Counters &counters, GLenum target, GLintptr, GLsizeiptr size, const void *) {
+		count_bytes(counters, target, size);
+	}
+};
+
+template< >
+struct Observe< GLFunction_MapBufferRange > {
+	static void call(GLInstrument::Counters &counters, GLenum target, GLintptr, GLsizeiptr length, GLbitfield access) {
+		if (access & GL_MAP_WRITE_BIT) count_bytes(counters, target, length);
+	}
+};
+
+template< >
+struct Observe< GLFunction_DrawArrays > {
+	static void call(GLInstrument::Counters &counters, GLenum, GLint, GLsizei count) {
+		counters.vertices += uint64_t(count);
+	}
+};
+
+//one wrapper per entry point, holding the driver's function:
+template< uint32_t F, typename Proc >
+struct Wrapper;
+
+template< uint32_t F, typename R, typename... Args >
+struct Wrapper< F, R (APIENTRYP)(Args...) > {
+	typedef R (APIENTRYP Proc)(Args...);
+	static Proc real;
+
+	static R APIENTRY call(Args... args) {
+		GLInstrument &instrument = gl_instrument();
+		++instrument.frame.calls[F];
+		if (instrument.kind[F] == GLInstrument::Draw) ++instrument.frame.draws;
+		Observe< F >::call(instrument.frame, args...);
+		if (!instrument.timed[F]) return real(args...);
+		CallTimer timer(instrument.frame.ms[F]);
+		return real(args...);
+	}
+};
+
+template< uint32_t F, typename R, typename... Args >
+typename Wrapper< F, R (APIENTRYP)(Args...) >::Proc Wrapper< F, R (APIENTRYP)(Args...) >::real = nullptr;
+
+bool starts_with(char const *str, char const *prefix) {
+	return std::strncmp(str, prefix, std::strlen(prefix)) == 0;
+}
+
+}
+
+void init_gl_instrument() {
+	GLInstrument &instrument = gl_instrument();
+
+	//sort entry points by name into kinds, and pick the ones worth timing:
+	for (uint32_t f = 0; f < GLFunctionCount; ++f) {
+		char const *name = GLInstrument::name(GLFunction(f)) + 2; //(skip "gl")
+
+		GLInstrument::Kind kind = GLInstrument::Other;
+		if (starts_with(name, "Draw") || starts_with(name, "MultiDraw")) {
+			kind = GLInstrument::Draw;
+		} else if (starts_with(name, "Uniform") && !starts_with(name, "UniformBlockBinding")) {
+			kind = GLInstrument::Uniform;
+		} else if (starts_with(name, "Get") || starts_with(name, "Is") || starts_with(name, "CheckFramebufferStatus")) {
+			kind = GLInstrument::Query;
+		} else {
+			static char const *state_prefixes[] = {
+				"Bind", "Enable", "Disable", "UseProgram", "Blend", "Depth", "Stencil", "ColorMask",
+				"CullFace", "FrontFace", "PolygonMode", "Viewport", "Scissor", "ClearColor", "ClearDepth",
+				"PixelStore", "VertexAttribPointer", "VertexAttribIPointer", "ActiveTexture",
+			};
+			for (char const *prefix : state_prefixes) {
+				if (starts_with(name, prefix)) kind = GLInstrument::State;
+			}
+		}
+		instrument.kind[f] = kind;
+
+		//calls that may wait on the GPU, copy data, or compile:
+		static char const *timed_prefixes[] = {
+			"Draw", "MultiDraw", "Clear", "BlitFramebuffer", "Finish", "Flush", "ClientWaitSync",
+			"BufferData", "BufferSubData", "MapBuffer", "UnmapBuffer", "ReadPixels", "GetQueryObject",
+			"TexImage", "TexSubImage", "CompileShader", "LinkProgram",
+		};
+		bool timed = false;
+		for (char const *prefix : timed_prefixes) {
+			if (starts_with(name, prefix)) timed = true;
+		}
+		instrument.timed[f] = timed;
+	}
+
+	//swap each entry point for its wrapper:
+	#undef GL_SHIMS_HPP
+	#define DO(TYPE, NAME) \
+		if (!gl ## NAME) throw std::runtime_error("init_gl_instrument: gl" #NAME " isn't loaded (call init_gl_shims() first)."); \
+		Wrapper< GLFunction_ ## NAME, PFNGL ## TYPE ## PROC >::real = gl ## NAME; \
+		gl ## NAME = &Wrapper< GLFunction_ ## NAME, PFNGL ## TYPE ## PROC >::call;
+	#include "gl_shims.hpp"
+	#undef DO
+}
+
+#endif //GL_INSTRUMENT
@@ -0,0 +1,77 @@
+#pragma once
+
+//Instrumented GL: builds made with 'jam -sGL_INSTRUMENT=1' (Linux) call every GL
+// entry point through a pointer, as Windows builds do (see gl_shims.hpp, which
+// also loads the GL 1.0 functions in these builds). After init_gl_shims(),
+// init_gl_instrument() points each one at a wrapper that counts the call --
+// timing it too, if it's one that can stall or copy a lot -- before calling the
+// driver's function. So driver overhead shows up during normal play:
+//   jam -sGL_INSTRUMENT=1 && dist/main   (prints a report on exit)
+//
+//Counts are the mock's GLCallCounts (gl_call_counts.hpp), plus time in the timed
+// entry points, so an instrumented build's report lines up with a mock build's.
+// end_frame() also keeps a summary of each finished frame in 'last'.
+
+#include "GL.hpp"
+#include "gl_call_counts.hpp"
+
+#include <cstdint>
+#include <iostream>
+
+//every entry point in gl_shims.hpp's DO list:
+enum GLFunction : uint16_t {
+	#undef DO
+	#undef GL_SHIMS_HPP
+	#define DO(TYPE, NAME) GLFunction_ ## NAME,
+	#include "gl_shims.hpp"
+	#undef DO
+	GLFunctionCount
+};
+
+struct GLInstrument {
+	//what a call does, for the per-frame totals:
+	enum Kind : uint8_t {
+		Other,
+		Draw, //glDraw*
+		Uniform, //glUniform* (uniform buffer data is counted in uniform_bytes)
+		State, //binds, enables, blend/depth/viewport/... settings
+		Query, //glGet*, glIs*, glCheckFramebufferStatus (may stall)
+	};
+
+	struct Counters : GLCallCounts< GLFunctionCount > {
+		double ms[GLFunctionCount] = {}; //time spent in timed entry points
+	};
+	Counters frame; //counts since the last end_frame()
+	Counters total; //counts over all finished frames
+	uint64_t frames = 0;
+
+	//totals for one frame (e.g., for an overlay):
+	struct Summary {
+		uint64_t calls = 0;
+		uint64_t draws = 0;
+		uint64_t uniform_calls = 0; //glUniform*
+		uint64_t state_changes = 0;
+		uint64_t queries = 0;
+		uint64_t buffer_bytes = 0;
+		uint64_t uniform_bytes = 0;
+		double timed_ms = 0.0; //time in the timed entry points
+	};
+	Summary last; //the most recently finished frame
+	Summary summarize(Counters const &counters) const;
+
+	//accumulate 'frame' into 'total' (and 'last') and reset it:
+	void end_frame();
+
+	//print per-frame averages, then the entry points that took the most time and were called most:
+	void report(std::ostream &out) const;
+
+	//set up by init_gl_instrument():
+	Kind kind[GLFunctionCount];
+	bool timed[GLFunctionCount];
+	static char const *name(uint32_t function);
+};
+
+GLInstrument &gl_instrument();
+
+//wrap every entry point (call after init_gl_shims(); throws on failure):
+void init_gl_instrument();
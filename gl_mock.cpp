@@ -0,0 +1,241 @@
+//(this file defines the real entry points, so tracing mustn't rename them)
+#define GL_TRACE_NO_REDIRECT
+#include "gl_mock.hpp"
+
+#ifdef GL_MOCK
+
+#include "GL.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+//(as in shader_manager.cpp)
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+GLMock &gl_mock() {
+	static GLMock mock;
+	return mock;
+}
+
+char const *GLMock::name(uint32_t function) {
+	static char const *names[FunctionCount] = {
+		#define DO(NAME) "gl" #NAME,
+		GL_MOCK_FUNCTIONS(DO)
+		#undef DO
+	};
+	return (function < FunctionCount ? names[function] : "?");
+}
+
+void GLMock::end_frame() {
+	total.add(frame);
+	max_frame_calls = std::max(max_frame_calls, frame.total_calls());
+	++frames;
+	frame = Counters();
+}
+
+void GLMock::clear() {
+	total = Counters();
+	frames = 0;
+	max_frame_calls = 0;
+}
+
+void GLMock::report(std::ostream &out) const {
+	if (frames == 0) return;
+	double per = 1.0 / double(frames);
+	out << "Mock GL per frame: ";
+	total.print_per_frame(out, per);
+	out << "; at most " << max_frame_calls << " calls in a frame; over " << frames << " frames." << std::endl;
+	total.print_calls(out, &GLMock::name, per);
+}
+
+//---- the mock itself ----
+
+namespace {
+
+//object names are handed out from one counter (real drivers reuse them, but nothing here relies on that):
+GLuint next_name = 1;
+uintptr_t next_sync = 1;
+
+//buffers get memory only when mapped (so glBufferData stays free), and keep it for next time:
+std::unordered_map< GLenum, GLuint > bound_buffers;
+std::unordered_map< GLuint, std::vector< char > > mapped_memory;
+
+inline GLMock::Counters &count(GLMock::Function function) {
+	GLMock::Counters &frame = gl_mock().frame;
+	++frame.calls[function];
+	return frame;
+}
+
+inline void count_bytes(GLenum target, uint64_t bytes) {
+	gl_mock().frame.count_bytes(bytes, target == GL_UNIFORM_BUFFER);
+}
+
+inline void gen_names(GLsizei n, GLuint *names) {
+	for (GLsizei i = 0; i < n; ++i) names[i] = next_name++;
+}
+
+}
+
+void APIENTRY glAttachShader(GLuint, GLuint) { count(GLMock::AttachShader); }
+void APIENTRY glBeginQuery(GLenum, GLuint) { count(GLMock::BeginQuery); }
+void APIENTRY glBindBuffer(GLenum target, GLuint buffer) {
+	count(GLMock::BindBuffer);
+	bound_buffers[target] = buffer;
+}
+void APIENTRY glBindBufferBase(GLenum target, GLuint, GLuint buffer) {
+	count(GLMock::BindBufferBase);
+	bound_buffers[target] = buffer;
+}
+void APIENTRY glBindBufferRange(GLenum target, GLuint, GLuint buffer, GLintptr, GLsizeiptr) {
+	count(GLMock::BindBufferRange);
+	bound_buffers[target] = buffer;
+}
+void APIENTRY glBindFramebuffer(GLenum, GLuint) { count(GLMock::BindFramebuffer); }
+void APIENTRY glBindRenderbuffer(GLenum, GLuint) { count(GLMock::BindRenderbuffer); }
+void APIENTRY glBindVertexArray(GLuint) { count(GLMock::BindVertexArray); }
+void APIENTRY glBlendFunc(GLenum, GLenum) { count(GLMock::BlendFunc); }
+void APIENTRY glBlitFramebuffer(GLint, GLint, GLint, GLint, GLint, GLint, GLint, GLint, GLbitfield, GLenum) { count(GLMock::BlitFramebuffer); }
+void APIENTRY glBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum) {
+	count(GLMock::BufferData);
+	if (data) count_bytes(target, uint64_t(size));
+}
+void APIENTRY glBufferSubData(GLenum target, GLintptr, GLsizeiptr size, const void *) {
+	count(GLMock::BufferSubData);
+	count_bytes(target, uint64_t(size));
+}
+GLenum APIENTRY glCheckFramebufferStatus(GLenum) {
+	count(GLMock::CheckFramebufferStatus);
+	return GL_FRAMEBUFFER_COMPLETE;
+}
+void APIENTRY glClear(GLbitfield) { count(GLMock::Clear); }
+void APIENTRY glClearColor(GLfloat, GLfloat, GLfloat, GLfloat) { count(GLMock::ClearColor); }
+GLenum APIENTRY glClientWaitSync(GLsync, GLbitfield, GLuint64) {
+	count(GLMock::ClientWaitSync);
+	return GL_ALREADY_SIGNALED;
+}
+void APIENTRY glCompileShader(GLuint) { count(GLMock::CompileShader); }
+GLuint APIENTRY glCreateProgram() {
+	count(GLMock::CreateProgram);
+	return next_name++;
+}
+GLuint APIENTRY glCreateShader(GLenum) {
+	count(GLMock::CreateShader);
+	return next_name++;
+}
+void APIENTRY glDeleteBuffers(GLsizei n, const GLuint *buffers) {
+	count(GLMock::DeleteBuffers);
+	for (GLsizei i = 0; i < n; ++i) mapped_memory.erase(buffers[i]);
+}
+void APIENTRY glDeleteFramebuffers(GLsizei, const GLuint *) { count(GLMock::DeleteFramebuffers); }
+void APIENTRY glDeleteProgram(GLuint) { count(GLMock::DeleteProgram); }
+void APIENTRY glDeleteQueries(GLsizei, const GLuint *) { count(GLMock::DeleteQueries); }
+void APIENTRY glDeleteRenderbuffers(GLsizei, const GLuint *) { count(GLMock::DeleteRenderbuffers); }
+void APIENTRY glDeleteShader(GLuint) { count(GLMock::DeleteShader); }
+void APIENTRY glDeleteSync(GLsync) { count(GLMock::DeleteSync); }
+void APIENTRY glDeleteVertexArrays(GLsizei, const GLuint *) { count(GLMock::DeleteVertexArrays); }
+void APIENTRY glDepthMask(GLboolean) { count(GLMock::DepthMask); }
+void APIENTRY glDisable(GLenum) { count(GLMock::Disable); }
+void APIENTRY glDrawArrays(GLenum, GLint, GLsizei count_) {
+	GLMock::Counters &frame = count(GLMock::DrawArrays);
+	++frame.draws;
+	frame.vertices += uint64_t(count_);
+}
+void APIENTRY glEnable(GLenum) { count(GLMock::Enable); }
+void APIENTRY glEnableVertexAttribArray(GLuint) { count(GLMock::EnableVertexAttribArray); }
+void APIENTRY glEndQuery(GLenum) { count(GLMock::EndQuery); }
+GLsync APIENTRY glFenceSync(GLenum, GLbitfield) {
+	count(GLMock::FenceSync);
+	return reinterpret_cast< GLsync >(next_sync++);
+}
+void APIENTRY glFinish() { count(GLMock::Finish); }
+void APIENTRY glFramebufferRenderbuffer(GLenum, GLenum, GLenum, GLuint) { count(GLMock::FramebufferRenderbuffer); }
+void APIENTRY glGenBuffers(GLsizei n, GLuint *buffers) {
+	count(GLMock::GenBuffers);
+	gen_names(n, buffers);
+}
+void APIENTRY glGenFramebuffers(GLsizei n, GLuint *framebuffers) {
+	count(GLMock::GenFramebuffers);
+	gen_names(n, framebuffers);
+}
+void APIENTRY glGenQueries(GLsizei n, GLuint *ids) {
+	count(GLMock::GenQueries);
+	gen_names(n, ids);
+}
+void APIENTRY glGenRenderbuffers(GLsizei n, GLuint *renderbuffers) {
+	count(GLMock::GenRenderbuffers);
+	gen_names(n, renderbuffers);
+}
+void APIENTRY glGenVertexArrays(GLsizei n, GLuint *arrays) {
+	count(GLMock::GenVertexArrays);
+	gen_names(n, arrays);
+}
+GLenum APIENTRY glGetError() {
+	count(GLMock::GetError);
+	return GL_NO_ERROR;
+}
+void APIENTRY glGetIntegerv(GLenum pname, GLint *data) {
+	count(GLMock::GetIntegerv);
+	//(the strictest alignment real drivers ask for)
+	*data = (pname == GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT ? 256 : 0);
+}
+void APIENTRY glGetProgramInfoLog(GLuint, GLsizei bufSize, GLsizei *length, GLchar *infoLog) {
+	count(GLMock::GetProgramInfoLog);
+	if (length) *length = 0;
+	if (bufSize > 0) infoLog[0] = '\0';
+}
+void APIENTRY glGetProgramiv(GLuint, GLenum pname, GLint *params) {
+	count(GLMock::GetProgramiv);
+	//linked (and done linking), with an empty log and no binary:
+	*params = (pname == GL_LINK_STATUS || pname == GL_COMPLETION_STATUS_KHR ? GL_TRUE : 0);
+}
+void APIENTRY glGetQueryObjectiv(GLuint, GLenum, GLint *params) {
+	count(GLMock::GetQueryObjectiv);
+	*params = GL_TRUE; //(the only thing asked is whether a result is available)
+}
+void APIENTRY glGetQueryObjectui64v(GLuint, GLenum, GLuint64 *params) {
+	count(GLMock::GetQueryObjectui64v);
+	*params = 0;
+}
+void APIENTRY glGetShaderInfoLog(GLuint, GLsizei bufSize, GLsizei *length, GLchar *infoLog) {
+	count(GLMock::GetShaderInfoLog);
+	if (length) *length = 0;
+	if (bufSize > 0) infoLog[0] = '\0';
+}
+void APIENTRY glGetShaderiv(GLuint, GLenum pname, GLint *params) {
+	count(GLMock::GetShaderiv);
+	*params = (pname == GL_COMPILE_STATUS ? GL_TRUE : 0);
+}
+const GLubyte *APIENTRY glGetString(GLenum name) {
+	count(GLMock::GetString);
+	char const *str = (name == GL_VERSION ? "3.3 (mock)" : "mock");
+	return reinterpret_cast< GLubyte const * >(str);
+}
+GLuint APIENTRY glGetUniformBlockIndex(GLuint, const GLchar *) {
+	count(GLMock::GetUniformBlockIndex);
+	return 0;
+}
+void APIENTRY glLinkProgram(GLuint) { count(GLMock::LinkProgram); }
+void *APIENTRY glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+	count(GLMock::MapBufferRange);
+	if (access & GL_MAP_WRITE_BIT) count_bytes(target, uint64_t(length));
+	std::vector< char > &memory = mapped_memory[bound_buffers[target]];
+	if (memory.size() < size_t(offset + length)) memory.resize(size_t(offset + length));
+	return memory.data() + offset;
+}
+void APIENTRY glPixelStorei(GLenum, GLint) { count(GLMock::PixelStorei); }
+void APIENTRY glReadPixels(GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, void *) { count(GLMock::ReadPixels); }
+void APIENTRY glRenderbufferStorage(GLenum, GLenum, GLsizei, GLsizei) { count(GLMock::RenderbufferStorage); }
+void APIENTRY glShaderSource(GLuint, GLsizei, const GLchar *const *, const GLint *) { count(GLMock::ShaderSource); }
+void APIENTRY glUniformBlockBinding(GLuint, GLuint, GLuint) { count(GLMock::UniformBlockBinding); }
+GLboolean APIENTRY glUnmapBuffer(GLenum) {
+	count(GLMock::UnmapBuffer);
+	return GL_TRUE;
+}
+void APIENTRY glUseProgram(GLuint) { count(GLMock::UseProgram); }
+void APIENTRY glVertexAttribPointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void *) { count(GLMock::VertexAttribPointer); }
+void APIENTRY glViewport(GLint, GLint, GLsizei, GLsizei) { count(GLMock::Viewport); }
+
+#endif //GL_MOCK
@@ -0,0 +1,61 @@
+#pragma once
+
+//Mock GL: builds made with 'jam -sGL_MOCK=1' (on Linux) link gl_mock.cpp,
+// which defines every GL entry point the game uses as a function that does next
+// to nothing -- it hands out object names, answers queries with "done" and "ok",
+// gives mappings some memory to write into -- and counts what it was asked to do.
+//
+//With no driver underneath, 'dist/headless' in a mock build measures the CPU cost
+// of Game::update and Game::draw's submission alone (and needs no GPU or EGL):
+//   jam -sGL_MOCK=1 && dist/headless --bench level1.map --max-gl-calls 2000
+//
+//Counts are kept per frame, like GLStateCache's: end_frame() rolls them into the totals.
+// They're GLCallCounts (gl_call_counts.hpp), as in instrumented builds, so the two reports compare.
+
+#include "gl_call_counts.hpp"
+
+#include <cstdint>
+#include <iostream>
+
+//every mocked entry point (without its 'gl' prefix):
+#define GL_MOCK_FUNCTIONS(DO) \
+	DO(AttachShader) DO(BeginQuery) DO(BindBuffer) DO(BindBufferBase) DO(BindBufferRange) \
+	DO(BindFramebuffer) DO(BindRenderbuffer) DO(BindVertexArray) DO(BlendFunc) DO(BlitFramebuffer) \
+	DO(BufferData) DO(BufferSubData) DO(CheckFramebufferStatus) DO(Clear) DO(ClearColor) \
+	DO(ClientWaitSync) DO(CompileShader) DO(CreateProgram) DO(CreateShader) DO(DeleteBuffers) \
+	DO(DeleteFramebuffers) DO(DeleteProgram) DO(DeleteQueries) DO(DeleteRenderbuffers) DO(DeleteShader) \
+	DO(DeleteSync) DO(DeleteVertexArrays) DO(DepthMask) DO(Disable) DO(DrawArrays) \
+	DO(Enable) DO(EnableVertexAttribArray) DO(EndQuery) DO(FenceSync) DO(Finish) \
+	DO(FramebufferRenderbuffer) DO(GenBuffers) DO(GenFramebuffers) DO(GenQueries) DO(GenRenderbuffers) \
+	DO(GenVertexArrays) DO(GetError) DO(GetIntegerv) DO(GetProgramInfoLog) DO(GetProgramiv) \
+	DO(GetQueryObjectiv) DO(GetQueryObjectui64v) DO(GetShaderInfoLog) DO(GetShaderiv) DO(GetString) \
+	DO(GetUniformBlockIndex) DO(LinkProgram) DO(MapBufferRange) DO(PixelStorei) DO(ReadPixels) \
+	DO(RenderbufferStorage) DO(ShaderSource) DO(UniformBlockBinding) DO(UnmapBuffer) DO(UseProgram) \
+	DO(VertexAttribPointer) DO(Viewport)
+
+struct GLMock {
+	enum Function {
+		#undef DO
+		#define DO(NAME) NAME,
+		GL_MOCK_FUNCTIONS(DO)
+		#undef DO
+		FunctionCount
+	};
+	static char const *name(uint32_t function);
+
+	typedef GLCallCounts< FunctionCount > Counters;
+	Counters frame; //counts since the last end_frame()
+	Counters total; //counts over all finished frames
+	uint64_t frames = 0;
+	uint64_t max_frame_calls = 0; //most calls in any finished frame
+
+	//accumulate 'frame' into 'total' and reset it:
+	void end_frame();
+	//forget the totals (e.g., after warm-up frames):
+	void clear();
+
+	//print per-frame averages, and calls per frame for each entry point used:
+	void report(std::ostream &out) const;
+};
+
+GLMock &gl_mock();
@@ -0,0 +1,527 @@
+//gl_replay.cpp is the entry point of 'dist/gl-replay' (Linux only), which plays
+// back a GL trace recorded by a 'jam -sGL_TRACE=1' build (see gl_trace.hpp)
+// into an offscreen EGL context, over and over, and reports how long each frame
+// took to submit and to finish.
+//
+//Frames before the replayed range are played once first (that's where buffers
+// and programs get created); the range itself is then looped. Each frame ends
+// with a glFinish, so frames are timed separately -- and a loop wrapping around
+// never overwrites buffers the GPU is still reading.
+
+//(calls here are the real ones, even in GL_TRACE builds)
+#define GL_TRACE_NO_REDIRECT
+#include "gl_trace.hpp"
+#include "headless_context.hpp"
+#include "read_chunk.hpp"
+#include "sample_stats.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+//reads arguments back in the order gl_trace.cpp wrote them:
+struct Reader {
+	std::vector< uint8_t > const &commands;
+	size_t at;
+
+	template< typename T >
+	T get() {
+		if (at + sizeof(T) > commands.size()) throw std::runtime_error("GL trace ends in the middle of a call.");
+		T value;
+		std::memcpy(&value, &commands[at], sizeof(T));
+		at += sizeof(T);
+		return value;
+	}
+	//a length-prefixed payload (points into the trace):
+	void const *get_bytes(uint32_t *size) {
+		*size = get< uint32_t >();
+		if (at + *size > commands.size()) throw std::runtime_error("GL trace ends in the middle of a payload.");
+		void const *data = (*size ? &commands[at] : nullptr);
+		at += *size;
+		return data;
+	}
+};
+
+//recorded object names -> names in this context:
+struct Names {
+	std::unordered_map< GLuint, GLuint > map;
+	GLuint operator[](GLuint recorded) const {
+		if (recorded == 0) return 0;
+		auto f = map.find(recorded);
+		return (f == map.end() ? 0 : f->second);
+	}
+};
+
+struct Replayer {
+	GLuint default_framebuffer = 0; //stands in for the window's framebuffer
+
+	Names buffers, framebuffers, queries, renderbuffers, vertex_arrays;
+	Names programs; //(programs and shaders share a namespace)
+	std::unordered_map< uint64_t, GLsync > syncs;
+	//(program in this context << 32 | recorded block index) -> block index in this context:
+	std::unordered_map< uint64_t, GLuint > block_indices;
+	//recorded buffer name -> where it is mapped in this context:
+	std::unordered_map< GLuint, void * > mappings;
+	std::vector< uint8_t > scratch; //for glReadPixels into client memory
+
+	//read names made by glGen*; a name made again (when a loop wraps around) replaces its old object:
+	template< typename Gen, typename Delete >
+	void gen(Reader &r, Names &names, Gen const &gen_fn, Delete const &delete_fn) {
+		GLsizei n = r.get< GLsizei >();
+		for (GLsizei i = 0; i < n; ++i) {
+			GLuint recorded = r.get< GLuint >();
+			auto f = names.map.find(recorded);
+			if (f != names.map.end()) delete_fn(1, &f->second);
+			GLuint name = 0;
+			gen_fn(1, &name);
+			names.map[recorded] = name;
+		}
+	}
+	template< typename Delete >
+	void del(Reader &r, Names &names, Delete const &delete_fn) {
+		GLsizei n = r.get< GLsizei >();
+		for (GLsizei i = 0; i < n; ++i) {
+			GLuint recorded = r.get< GLuint >();
+			auto f = names.map.find(recorded);
+			if (f == names.map.end()) continue;
+			delete_fn(1, &f->second);
+			names.map.erase(f);
+		}
+	}
+	void created(Names &names, GLuint recorded, GLuint name) {
+		auto f = names.map.find(recorded);
+		if (f != names.map.end()) {
+			if (glIsProgram(f->second)) glDeleteProgram(f->second);
+			else glDeleteShader(f->second);
+		}
+		names.map[recorded] = name;
+	}
+
+	//issue every call in [begin, end):
+	void play(std::vector< uint8_t > const &commands, size_t begin, size_t end);
+};
+
+void Replayer::play(std::vector< uint8_t > const &commands, size_t begin, size_t end) {
+	Reader r{commands, begin};
+	while (r.at < end) {
+		GLTraceOp op = r.get< GLTraceOp >();
+		switch (op) {
+			case GLTraceAttachShader: {
+				GLuint program = programs[r.get< GLuint >()];
+				GLuint shader = programs[r.get< GLuint >()];
+				glAttachShader(program, shader);
+			} break;
+			case GLTraceBeginQuery: {
+				GLenum target = r.get< GLenum >();
+				glBeginQuery(target, queries[r.get< GLuint >()]);
+			} break;
+			case GLTraceBindBuffer: {
+				GLenum target = r.get< GLenum >();
+				glBindBuffer(target, buffers[r.get< GLuint >()]);
+			} break;
+			case GLTraceBindBufferBase: {
+				GLenum target = r.get< GLenum >();
+				GLuint index = r.get< GLuint >();
+				glBindBufferBase(target, index, buffers[r.get< GLuint >()]);
+			} break;
+			case GLTraceBindBufferRange: {
+				GLenum target = r.get< GLenum >();
+				GLuint index = r.get< GLuint >();
+				GLuint buffer = buffers[r.get< GLuint >()];
+				GLintptr offset = r.get< GLintptr >();
+				GLsizeiptr size = r.get< GLsizeiptr >();
+				glBindBufferRange(target, index, buffer, offset, size);
+			} break;
+			case GLTraceBindFramebuffer: {
+				GLenum target = r.get< GLenum >();
+				GLuint recorded = r.get< GLuint >();
+				//(framebuffers made before recording started -- e.g., dist/headless's -- were stand-ins for the window too)
+				auto f = framebuffers.map.find(recorded);
+				glBindFramebuffer(target, f == framebuffers.map.end() ? default_framebuffer : f->second);
+			} break;
+			case GLTraceBindRenderbuffer: {
+				GLenum target = r.get< GLenum >();
+				glBindRenderbuffer(target, renderbuffers[r.get< GLuint >()]);
+			} break;
+			case GLTraceBindVertexArray: {
+				glBindVertexArray(vertex_arrays[r.get< GLuint >()]);
+			} break;
+			case GLTraceBlendFunc: {
+				GLenum sfactor = r.get< GLenum >();
+				GLenum dfactor = r.get< GLenum >();
+				glBlendFunc(sfactor, dfactor);
+			} break;
+			case GLTraceBlitFramebuffer: {
+				GLint coords[8];
+				for (GLint &c : coords) c = r.get< GLint >();
+				GLbitfield mask = r.get< GLbitfield >();
+				GLenum filter = r.get< GLenum >();
+				glBlitFramebuffer(coords[0], coords[1], coords[2], coords[3], coords[4], coords[5], coords[6], coords[7], mask, filter);
+			} break;
+			case GLTraceBufferData: {
+				GLenum target = r.get< GLenum >();
+				GLsizeiptr size = r.get< GLsizeiptr >();
+				GLenum usage = r.get< GLenum >();
+				void const *data = nullptr;
+				if (r.get< uint8_t >()) {
+					uint32_t bytes = 0;
+					data = r.get_bytes(&bytes);
+				}
+				glBufferData(target, size, data, usage);
+			} break;
+			case GLTraceBufferSubData: {
+				GLenum target = r.get< GLenum >();
+				GLintptr offset = r.get< GLintptr >();
+				uint32_t bytes = 0;
+				void const *data = r.get_bytes(&bytes);
+				glBufferSubData(target, offset, bytes, data);
+			} break;
+			case GLTraceClear: {
+				glClear(r.get< GLbitfield >());
+			} break;
+			case GLTraceClearColor: {
+				GLfloat c[4];
+				for (GLfloat &v : c) v = r.get< GLfloat >();
+				glClearColor(c[0], c[1], c[2], c[3]);
+			} break;
+			case GLTraceClientWaitSync: {
+				uint64_t id = r.get< uint64_t >();
+				GLbitfield flags = r.get< GLbitfield >();
+				GLuint64 timeout = r.get< GLuint64 >();
+				GLenum result = r.get< GLenum >();
+				auto f = syncs.find(id);
+				if (f == syncs.end()) break; //(fenced before the replayed range)
+				if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) {
+					//the game went on to rely on this fence, so the replay waits for it too:
+					while (glClientWaitSync(f->second, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) { }
+				} else {
+					glClientWaitSync(f->second, flags, timeout);
+				}
+			} break;
+			case GLTraceCompileShader: {
+				glCompileShader(programs[r.get< GLuint >()]);
+			} break;
+			case GLTraceCreateProgram: {
+				created(programs, r.get< GLuint >(), glCreateProgram());
+			} break;
+			case GLTraceCreateShader: {
+				GLenum type = r.get< GLenum >();
+				created(programs, r.get< GLuint >(), glCreateShader(type));
+			} break;
+			case GLTraceDeleteBuffers: {
+				del(r, buffers, glDeleteBuffers);
+			} break;
+			case GLTraceDeleteFramebuffers: {
+				del(r, framebuffers, glDeleteFramebuffers);
+			} break;
+			case GLTraceDeleteProgram:
+			case GLTraceDeleteShader: {
+				GLuint recorded = r.get< GLuint >();
+				auto f = programs.map.find(recorded);
+				if (f == programs.map.end()) break;
+				if (op == GLTraceDeleteProgram) glDeleteProgram(f->second);
+				else glDeleteShader(f->second);
+				programs.map.erase(f);
+			} break;
+			case GLTraceDeleteQueries: {
+				del(r, queries, glDeleteQueries);
+			} break;
+			case GLTraceDeleteRenderbuffers: {
+				del(r, renderbuffers, glDeleteRenderbuffers);
+			} break;
+			case GLTraceDeleteSync: {
+				auto f = syncs.find(r.get< uint64_t >());
+				if (f == syncs.end()) break;
+				glDeleteSync(f->second);
+				syncs.erase(f);
+			} break;
+			case GLTraceDeleteVertexArrays: {
+				del(r, vertex_arrays, glDeleteVertexArrays);
+			} break;
+			case GLTraceDepthMask: {
+				glDepthMask(r.get< GLboolean >());
+			} break;
+			case GLTraceDisable: {
+				glDisable(r.get< GLenum >());
+			} break;
+			case GLTraceDrawArrays: {
+				GLenum mode = r.get< GLenum >();
+				GLint first = r.get< GLint >();
+				GLsizei count = r.get< GLsizei >();
+				glDrawArrays(mode, first, count);
+			} break;
+			case GLTraceEnable: {
+				glEnable(r.get< GLenum >());
+			} break;
+			case GLTraceEnableVertexAttribArray: {
+				glEnableVertexAttribArray(r.get< GLuint >());
+			} break;
+			case GLTraceEndQuery: {
+				glEndQuery(r.get< GLenum >());
+			} break;
+			case GLTraceFenceSync: {
+				GLenum condition = r.get< GLenum >();
+				GLbitfield flags = r.get< GLbitfield >();
+				uint64_t id = r.get< uint64_t >();
+				auto f = syncs.find(id);
+				if (f != syncs.end()) glDeleteSync(f->second);
+				syncs[id] = glFenceSync(condition, flags);
+			} break;
+			case GLTraceFinish: {
+				glFinish();
+			} break;
+			case GLTraceFramebufferRenderbuffer: {
+				GLenum target = r.get< GLenum >();
+				GLenum attachment = r.get< GLenum >();
+				GLenum renderbuffertarget = r.get< GLenum >();
+				glFramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffers[r.get< GLuint >()]);
+			} break;
+			case GLTraceGenBuffers: {
+				gen(r, buffers, glGenBuffers, glDeleteBuffers);
+			} break;
+			case GLTraceGenFramebuffers: {
+				gen(r, framebuffers, glGenFramebuffers, glDeleteFramebuffers);
+			} break;
+			case GLTraceGenQueries: {
+				gen(r, queries, glGenQueries, glDeleteQueries);
+			} break;
+			case GLTraceGenRenderbuffers: {
+				gen(r, renderbuffers, glGenRenderbuffers, glDeleteRenderbuffers);
+			} break;
+			case GLTraceGenVertexArrays: {
+				gen(r, vertex_arrays, glGenVertexArrays, glDeleteVertexArrays);
+			} break;
+			case GLTraceGetUniformBlockIndex: {
+				GLuint program = programs[r.get< GLuint >()];
+				GLuint recorded = r.get< GLuint >();
+				uint32_t bytes = 0;
+				char const *name = reinterpret_cast< char const * >(r.get_bytes(&bytes));
+				std::string block(name, name + bytes);
+				block_indices[(uint64_t(program) << 32) | recorded] = glGetUniformBlockIndex(program, block.c_str());
+			} break;
+			case GLTraceLinkProgram: {
+				glLinkProgram(programs[r.get< GLuint >()]);
+			} break;
+			case GLTraceMapBufferRange: {
+				GLenum target = r.get< GLenum >();
+				GLintptr offset = r.get< GLintptr >();
+				GLsizeiptr length = r.get< GLsizeiptr >();
+				GLbitfield access = r.get< GLbitfield >();
+				GLuint recorded = r.get< GLuint >();
+				mappings[recorded] = glMapBufferRange(target, offset, length, access);
+			} break;
+			case GLTracePixelStorei: {
+				GLenum pname = r.get< GLenum >();
+				glPixelStorei(pname, r.get< GLint >());
+			} break;
+			case GLTraceReadPixels: {
+				GLint x = r.get< GLint >();
+				GLint y = r.get< GLint >();
+				GLsizei width = r.get< GLsizei >();
+				GLsizei height = r.get< GLsizei >();
+				GLenum format = r.get< GLenum >();
+				GLenum type = r.get< GLenum >();
+				uint8_t to_buffer = r.get< uint8_t >();
+				uint64_t offset = r.get< uint64_t >();
+				void *pixels = reinterpret_cast< void * >(uintptr_t(offset));
+				if (!to_buffer) {
+					//(the game only reads RGBA8, so 4 bytes per pixel is enough)
+					scratch.resize(size_t(width) * height * 4);
+					pixels = scratch.data();
+				}
+				glReadPixels(x, y, width, height, format, type, pixels);
+			} break;
+			case GLTraceRenderbufferStorage: {
+				GLenum target = r.get< GLenum >();
+				GLenum internalformat = r.get< GLenum >();
+				GLsizei width = r.get< GLsizei >();
+				GLsizei height = r.get< GLsizei >();
+				glRenderbufferStorage(target, internalformat, width, height);
+			} break;
+			case GLTraceShaderSource: {
+				GLuint shader = programs[r.get< GLuint >()];
+				uint32_t bytes = 0;
+				GLchar const *source = reinterpret_cast< GLchar const * >(r.get_bytes(&bytes));
+				GLint length = GLint(bytes);
+				glShaderSource(shader, 1, &source, &length);
+			} break;
+			case GLTraceUniformBlockBinding: {
+				GLuint program = programs[r.get< GLuint >()];
+				GLuint recorded = r.get< GLuint >();
+				GLuint binding = r.get< GLuint >();
+				auto f = block_indices.find((uint64_t(program) << 32) | recorded);
+				glUniformBlockBinding(program, (f == block_indices.end() ? recorded : f->second), binding);
+			} break;
+			case GLTraceUnmapBuffer: {
+				GLenum target = r.get< GLenum >();
+				GLuint recorded = r.get< GLuint >();
+				uint32_t bytes = 0;
+				void const *data = r.get_bytes(&bytes);
+				auto f = mappings.find(recorded);
+				if (f != mappings.end()) {
+					if (f->second && bytes) std::memcpy(f->second, data, bytes);
+					mappings.erase(f);
+				}
+				glUnmapBuffer(target);
+			} break;
+			case GLTraceUseProgram: {
+				glUseProgram(programs[r.get< GLuint >()]);
+			} break;
+			case GLTraceVertexAttribPointer: {
+				GLuint index = r.get< GLuint >();
+				GLint size = r.get< GLint >();
+				GLenum type = r.get< GLenum >();
+				GLboolean normalized = r.get< GLboolean >();
+				GLsizei stride = r.get< GLsizei >();
+				uint64_t offset = r.get< uint64_t >();
+				glVertexAttribPointer(index, size, type, normalized, stride, reinterpret_cast< void const * >(uintptr_t(offset)));
+			} break;
+			case GLTraceViewport: {
+				GLint x = r.get< GLint >();
+				GLint y = r.get< GLint >();
+				GLsizei width = r.get< GLsizei >();
+				GLsizei height = r.get< GLsizei >();
+				glViewport(x, y, width, height);
+			} break;
+			default:
+				throw std::runtime_error("GL trace contains unknown call " + std::to_string(int(op)) + ".");
+		}
+	}
+}
+
+}
+
+static int run(int argc, char **argv) {
+	struct {
+		std::string trace = "";
+		uint32_t first = 0; //first frame to loop
+		uint32_t last = -1U; //(one past the) last frame to loop; clamped to the trace
+		uint32_t loops = 10;
+	} config;
+
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--frames" && argi + 1 < argc) {
+			unsigned int first = 0, last = 0;
+			if (std::sscanf(argv[++argi], "%u:%u", &first, &last) != 2 || last <= first) {
+				std::cerr << "Expecting --frames FIRST:LAST (with FIRST < LAST)." << std::endl;
+				return 1;
+			}
+			config.first = first;
+			config.last = last;
+		} else if (arg == "--loops" && argi + 1 < argc) {
+			config.loops = std::stoul(argv[++argi]);
+		} else if (config.trace == "" && arg.substr(0, 2) != "--") {
+			config.trace = arg;
+		} else {
+			config.trace = "";
+			break;
+		}
+	}
+	if (config.trace == "") {
+		std::cerr << "Usage:\n\t" << argv[0] << " trace.gltrace [--frames FIRST:LAST] [--loops 10]" << std::endl;
+		return 1;
+	}
+
+	std::vector< uint32_t > header;
+	std::vector< uint8_t > commands;
+	std::vector< uint32_t > frame_ends;
+	{
+		std::ifstream file(config.trace, std::ios::binary);
+		if (!file) {
+			std::cerr << "Failed to open GL trace '" << config.trace << "'." << std::endl;
+			return 1;
+		}
+		read_chunk(file, "gtr0", &header);
+		read_chunk(file, "cmd0", &commands);
+		read_chunk(file, "frm0", &frame_ends);
+	}
+	if (header.size() != 3 || header[0] != GLTraceVersion) {
+		std::cerr << "'" << config.trace << "' isn't a version " << GLTraceVersion << " GL trace." << std::endl;
+		return 1;
+	}
+	if (frame_ends.empty()) {
+		std::cerr << "'" << config.trace << "' contains no frames." << std::endl;
+		return 1;
+	}
+	config.last = std::min< uint32_t >(config.last, uint32_t(frame_ends.size()));
+	if (config.first >= config.last) {
+		std::cerr << "The trace only has " << frame_ends.size() << " frames." << std::endl;
+		return 1;
+	}
+	auto frame_begin = [&frame_ends](uint32_t frame) -> size_t {
+		return (frame == 0 ? 0 : frame_ends[frame - 1]);
+	};
+
+	glm::uvec2 size(header[1], header[2]);
+	HeadlessContext headless(size);
+
+	Replayer replayer;
+	replayer.default_framebuffer = headless.framebuffer;
+
+	typedef std::chrono::high_resolution_clock Clock;
+	auto ms_between = [](Clock::time_point a, Clock::time_point b) {
+		return std::chrono::duration< float, std::milli >(b - a).count();
+	};
+
+	//everything before the looped frames (resource creation, earlier frames) plays once:
+	replayer.play(commands, 0, frame_begin(config.first));
+	glFinish();
+
+	uint32_t frames = config.last - config.first;
+	std::vector< float > submit_ms, frame_ms;
+	submit_ms.reserve(size_t(frames) * config.loops);
+	frame_ms.reserve(size_t(frames) * config.loops);
+	for (uint32_t loop = 0; loop < config.loops; ++loop) {
+		for (uint32_t frame = config.first; frame < config.last; ++frame) {
+			Clock::time_point begin = Clock::now();
+			replayer.play(commands, frame_begin(frame), frame_ends[frame]);
+			Clock::time_point submitted = Clock::now();
+			glFinish();
+			Clock::time_point end = Clock::now();
+			submit_ms.emplace_back(ms_between(begin, submitted));
+			frame_ms.emplace_back(ms_between(begin, end));
+		}
+	}
+
+	GLenum error = glGetError();
+	if (error != GL_NO_ERROR) {
+		std::cerr << "WARNING: replay ended with GL error 0x" << std::hex << error << std::dec << "." << std::endl;
+	}
+
+	auto print = [](char const *name, std::vector< float > const &samples) {
+		SampleStats stats = summarize(samples);
+		std::cout << "  " << std::left << std::setw(7) << name << std::right << std::fixed << std::setprecision(3)
+			<< " mean " << std::setw(8) << stats.mean
+			<< "  p50 " << std::setw(8) << stats.p50
+			<< "  p95 " << std::setw(8) << stats.p95
+			<< "  p99 " << std::setw(8) << stats.p99
+			<< "  max " << std::setw(8) << stats.max << std::endl;
+	};
+	std::cout << "Replayed frames " << config.first << "-" << config.last - 1 << " of '" << config.trace << "' "
+		<< config.loops << " times at " << size.x << "x" << size.y << " (ms; 'frame' includes glFinish):" << std::endl;
+	print("submit", submit_ms);
+	print("frame", frame_ms);
+
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	//(e.g., a truncated or corrupt trace, or no EGL)
+	try {
+		return run(argc, argv);
+	} catch (std::exception &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	}
+}
@@ -6,6 +6,10 @@
 #include "glcorearb.h"
 
 void init_gl_shims(); //will throw on failure.
+
+//GL 1.0 functions are usually linked directly (opengl32.lib exports them);
+// builds that define GL_SHIMS_1_0 load them through pointers like the rest:
+#ifndef GL_SHIMS_1_0
 //Prototypes for 1.0,1.1 functionality, pretty sure that already exists:
 
 extern "C" {
@@ -64,6 +68,8 @@ GLAPI void APIENTRY glViewport (GLint x, GLint y, GLsizei width, GLsizei height)
 
 }
 
+#endif //GL_SHIMS_1_0
+
 #endif //PROTOTYPES
 
 //--------------------------------------------------------
@@ -73,6 +79,60 @@ GLAPI void APIENTRY glViewport (GLint x, GLint y, GLsizei width, GLsizei height)
 #endif
 
 
+#ifdef GL_SHIMS_1_0
+
+// GL_VERSION_1_0 (loaded):
+
+DO(CULLFACE, CullFace)
+DO(FRONTFACE, FrontFace)
+DO(HINT, Hint)
+DO(LINEWIDTH, LineWidth)
+DO(POINTSIZE, PointSize)
+DO(POLYGONMODE, PolygonMode)
+DO(SCISSOR, Scissor)
+DO(TEXPARAMETERF, TexParameterf)
+DO(TEXPARAMETERFV, TexParameterfv)
+DO(TEXPARAMETERI, TexParameteri)
+DO(TEXPARAMETERIV, TexParameteriv)
+DO(TEXIMAGE1D, TexImage1D)
+DO(TEXIMAGE2D, TexImage2D)
+DO(DRAWBUFFER, DrawBuffer)
+DO(CLEAR, Clear)
+DO(CLEARCOLOR, ClearColor)
+DO(CLEARSTENCIL, ClearStencil)
+DO(CLEARDEPTH, ClearDepth)
+DO(STENCILMASK, StencilMask)
+DO(COLORMASK, ColorMask)
+DO(DEPTHMASK, DepthMask)
+DO(DISABLE, Disable)
+DO(ENABLE, Enable)
+DO(FINISH, Finish)
+DO(FLUSH, Flush)
+DO(BLENDFUNC, BlendFunc)
+DO(LOGICOP, LogicOp)
+DO(STENCILFUNC, StencilFunc)
+DO(STENCILOP, StencilOp)
+DO(DEPTHFUNC, DepthFunc)
+DO(PIXELSTOREF, PixelStoref)
+DO(PIXELSTOREI, PixelStorei)
+DO(READBUFFER, ReadBuffer)
+DO(READPIXELS, ReadPixels)
+DO(GETBOOLEANV, GetBooleanv)
+DO(GETDOUBLEV, GetDoublev)
+DO(GETERROR, GetError)
+DO(GETFLOATV, GetFloatv)
+DO(GETINTEGERV, GetIntegerv)
+DO(GETSTRING, GetString)
+DO(GETTEXIMAGE, GetTexImage)
+DO(GETTEXPARAMETERFV, GetTexParameterfv)
+DO(GETTEXPARAMETERIV, GetTexParameteriv)
+DO(GETTEXLEVELPARAMETERFV, GetTexLevelParameterfv)
+DO(GETTEXLEVELPARAMETERIV, GetTexLevelParameteriv)
+DO(ISENABLED, IsEnabled)
+DO(DEPTHRANGE, DepthRange)
+DO(VIEWPORT, Viewport)
+
+#endif //GL_SHIMS_1_0
 
 // GL_VERSION_1_1 extensions:
 DO(DRAWARRAYS, DrawArrays)
@@ -134,6 +194,7 @@ DO(ISBUFFER, IsBuffer)
 DO(BUFFERDATA, BufferData)
 DO(BUFFERSUBDATA, BufferSubData)
 DO(GETBUFFERSUBDATA, GetBufferSubData)
+DO(MAPBUFFER, MapBuffer)
 DO(UNMAPBUFFER, UnmapBuffer)
 DO(GETBUFFERPARAMETERIV, GetBufferParameteriv)
 DO(GETBUFFERPOINTERV, GetBufferPointerv)
@@ -299,6 +360,7 @@ DO(CLEARBUFFERIV, ClearBufferiv)
 DO(CLEARBUFFERUIV, ClearBufferuiv)
 DO(CLEARBUFFERFV, ClearBufferfv)
 DO(CLEARBUFFERFI, ClearBufferfi)
+DO(GETSTRINGI, GetStringi)
 DO(ISRENDERBUFFER, IsRenderbuffer)
 DO(BINDRENDERBUFFER, BindRenderbuffer)
 DO(DELETERENDERBUFFERS, DeleteRenderbuffers)
@@ -319,6 +381,7 @@ DO(GENERATEMIPMAP, GenerateMipmap)
 DO(BLITFRAMEBUFFER, BlitFramebuffer)
 DO(RENDERBUFFERSTORAGEMULTISAMPLE, RenderbufferStorageMultisample)
 DO(FRAMEBUFFERTEXTURELAYER, FramebufferTextureLayer)
+DO(MAPBUFFERRANGE, MapBufferRange)
 DO(FLUSHMAPPEDBUFFERRANGE, FlushMappedBufferRange)
 DO(BINDVERTEXARRAY, BindVertexArray)
 DO(DELETEVERTEXARRAYS, DeleteVertexArrays)
@@ -360,4 +423,34 @@ DO(TEXIMAGE3DMULTISAMPLE, TexImage3DMultisample)
 DO(GETMULTISAMPLEFV, GetMultisamplefv)
 DO(SAMPLEMASKI, SampleMaski)
 
+// GL_VERSION_3_3 extensions:
+DO(BINDFRAGDATALOCATIONINDEXED, BindFragDataLocationIndexed)
+DO(GETFRAGDATAINDEX, GetFragDataIndex)
+DO(GENSAMPLERS, GenSamplers)
+DO(DELETESAMPLERS, DeleteSamplers)
+DO(ISSAMPLER, IsSampler)
+DO(BINDSAMPLER, BindSampler)
+DO(SAMPLERPARAMETERI, SamplerParameteri)
+DO(SAMPLERPARAMETERIV, SamplerParameteriv)
+DO(SAMPLERPARAMETERF, SamplerParameterf)
+DO(SAMPLERPARAMETERFV, SamplerParameterfv)
+DO(SAMPLERPARAMETERIIV, SamplerParameterIiv)
+DO(SAMPLERPARAMETERIUIV, SamplerParameterIuiv)
+DO(GETSAMPLERPARAMETERIV, GetSamplerParameteriv)
+DO(GETSAMPLERPARAMETERIIV, GetSamplerParameterIiv)
+DO(GETSAMPLERPARAMETERFV, GetSamplerParameterfv)
+DO(GETSAMPLERPARAMETERIUIV, GetSamplerParameterIuiv)
+DO(QUERYCOUNTER, QueryCounter)
+DO(GETQUERYOBJECTI64V, GetQueryObjecti64v)
+DO(GETQUERYOBJECTUI64V, GetQueryObjectui64v)
+DO(VERTEXATTRIBDIVISOR, VertexAttribDivisor)
+DO(VERTEXATTRIBP1UI, VertexAttribP1ui)
+DO(VERTEXATTRIBP1UIV, VertexAttribP1uiv)
+DO(VERTEXATTRIBP2UI, VertexAttribP2ui)
+DO(VERTEXATTRIBP2UIV, VertexAttribP2uiv)
+DO(VERTEXATTRIBP3UI, VertexAttribP3ui)
+DO(VERTEXATTRIBP3UIV, VertexAttribP3uiv)
+DO(VERTEXATTRIBP4UI, VertexAttribP4ui)
+DO(VERTEXATTRIBP4UIV, VertexAttribP4uiv)
+
 #endif //GL_SHIMS_HPP
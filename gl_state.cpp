@@ -0,0 +1,105 @@
+#include "gl_state.hpp"
+
+#include <stdexcept>
+
+GLStateCache &gl_state() {
+	static GLStateCache cache;
+	return cache;
+}
+
+void GLStateCache::use_program(GLuint program_) {
+	if (update(program, program_known, program_)) glUseProgram(program_);
+}
+
+void GLStateCache::bind_vertex_array(GLuint vertex_array_) {
+	if (update(vertex_array, vertex_array_known, vertex_array_)) glBindVertexArray(vertex_array_);
+}
+
+GLStateCache::BufferBinding &GLStateCache::buffer_binding(GLenum target) {
+	for (BufferBinding &b : buffers) {
+		if (b.target == target) return b;
+	}
+	for (BufferBinding &b : buffers) {
+		if (b.target == 0) {
+			b.target = target;
+			return b;
+		}
+	}
+	throw std::runtime_error("GLStateCache: too many buffer targets.");
+}
+
+void GLStateCache::bind_buffer(GLenum target, GLuint buffer) {
+	BufferBinding &b = buffer_binding(target);
+	if (update(b.buffer, b.known, buffer)) glBindBuffer(target, buffer);
+}
+
+void GLStateCache::bind_buffer_base(GLenum target, GLuint index, GLuint buffer) {
+	//(indexed bindings aren't tracked, so this always goes through)
+	glBindBufferBase(target, index, buffer);
+	++frame.issued;
+	BufferBinding &b = buffer_binding(target);
+	b.buffer = buffer;
+	b.known = true;
+}
+
+void GLStateCache::bind_buffer_range(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+	glBindBufferRange(target, index, buffer, offset, size);
+	++frame.issued;
+	BufferBinding &b = buffer_binding(target);
+	b.buffer = buffer;
+	b.known = true;
+}
+
+void GLStateCache::set_enabled(GLenum cap, bool enabled) {
+	Cap *slot = nullptr;
+	for (Cap &c : caps) {
+		if (c.cap == cap) {
+			slot = &c;
+			break;
+		}
+		if (c.cap == 0 && !slot) slot = &c;
+	}
+	if (!slot) throw std::runtime_error("GLStateCache: too many capabilities.");
+	slot->cap = cap;
+	if (update(slot->enabled, slot->known, enabled)) {
+		if (enabled) glEnable(cap);
+		else glDisable(cap);
+	}
+}
+
+void GLStateCache::blend_func(GLenum sfactor, GLenum dfactor) {
+	BlendFunc value = { sfactor, dfactor };
+	if (update(blend, blend_known, value)) glBlendFunc(sfactor, dfactor);
+}
+
+void GLStateCache::clear_color(GLfloat r, GLfloat g, GLfloat b, GLfloat a) {
+	Color value = { r, g, b, a };
+	if (update(clear, clear_known, value)) glClearColor(r, g, b, a);
+}
+
+void GLStateCache::depth_mask(GLboolean flag) {
+	if (update(depth_write, depth_write_known, flag)) glDepthMask(flag);
+}
+
+void GLStateCache::invalidate() {
+	program_known = false;
+	vertex_array_known = false;
+	for (BufferBinding &b : buffers) b.known = false;
+	for (Cap &c : caps) c.known = false;
+	blend_known = false;
+	clear_known = false;
+	depth_write_known = false;
+}
+
+void GLStateCache::end_frame() {
+	total.issued += frame.issued;
+	total.elided += frame.elided;
+	frame = Counters();
+	++frames;
+}
+
+void GLStateCache::report(std::ostream &out) const {
+	if (frames == 0) return;
+	out << "GL state calls per frame: " << double(total.issued) / frames << " issued, "
+	    << double(total.elided) / frames << " elided (" << frames << " frames)." << std::endl;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <cstdint>
+#include <iostream>
+
+//GLStateCache shadows the bits of OpenGL state the game changes every frame
+// (bound program, vertex array, buffers, enabled caps, blend func, clear color,
+// depth mask) and drops calls that wouldn't change anything:
+//   gl_state().use_program(program); //only calls glUseProgram if needed
+//
+//All state starts out "unknown", so the first call of each kind always goes
+// through. Code that changes tracked state without going through the cache
+// (or deletes a bound object) should call invalidate() afterward.
+//
+//Every call is counted as "issued" (passed to GL) or "elided" (dropped);
+// end_frame() rolls the per-frame counts into the totals.
+struct GLStateCache {
+	void use_program(GLuint program);
+	void bind_vertex_array(GLuint vertex_array);
+	void bind_buffer(GLenum target, GLuint buffer);
+	//glBindBufferBase also changes the generic binding for 'target':
+	void bind_buffer_base(GLenum target, GLuint index, GLuint buffer);
+	//(as does glBindBufferRange)
+	void bind_buffer_range(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+	void set_enabled(GLenum cap, bool enabled);
+	void blend_func(GLenum sfactor, GLenum dfactor);
+	void clear_color(GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+	void depth_mask(GLboolean flag);
+
+	//forget all tracked state:
+	void invalidate();
+
+	struct Counters {
+		uint64_t issued = 0;
+		uint64_t elided = 0;
+	};
+	Counters frame; //counts since the last end_frame()
+	Counters total; //counts over all finished frames
+	uint64_t frames = 0;
+
+	//accumulate 'frame' into 'total' and reset it:
+	void end_frame();
+
+	//print average issued/elided calls per frame:
+	void report(std::ostream &out) const;
+
+private:
+	//returns true (and counts an issued call) if 'cached' needs to change to 'value':
+	template< typename T >
+	bool update(T &cached, bool &known, T const &value) {
+		if (known && cached == value) {
+			++frame.elided;
+			return false;
+		}
+		cached = value;
+		known = true;
+		++frame.issued;
+		return true;
+	}
+
+	GLuint program = 0;
+	bool program_known = false;
+	GLuint vertex_array = 0;
+	bool vertex_array_known = false;
+
+	//generic buffer bindings, by target:
+	enum { MaxBufferTargets = 8 };
+	struct BufferBinding {
+		GLenum target = 0;
+		GLuint buffer = 0;
+		bool known = false;
+	} buffers[MaxBufferTargets];
+	BufferBinding &buffer_binding(GLenum target);
+
+	//enabled capabilities:
+	enum { MaxCaps = 8 };
+	struct Cap {
+		GLenum cap = 0;
+		bool enabled = false;
+		bool known = false;
+	} caps[MaxCaps];
+
+	struct BlendFunc {
+		GLenum sfactor, dfactor;
+		bool operator==(BlendFunc const &o) const { return sfactor == o.sfactor && dfactor == o.dfactor; }
+	} blend = { GL_ONE, GL_ZERO };
+	bool blend_known = false;
+
+	struct Color {
+		GLfloat r, g, b, a;
+		bool operator==(Color const &o) const { return r == o.r && g == o.g && b == o.b && a == o.a; }
+	} clear = { 0.0f, 0.0f, 0.0f, 0.0f };
+	bool clear_known = false;
+
+	GLboolean depth_write = GL_TRUE;
+	bool depth_write_known = false;
+};
+
+//the cache for the (one) GL context the game renders with:
+GLStateCache &gl_state();
@@ -0,0 +1,457 @@
+//(the wrappers below call the real entry points)
+#define GL_TRACE_NO_REDIRECT
+#include "gl_trace.hpp"
+
+#ifdef GL_TRACE
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+//GL calls are only made on the main thread, so the recorder needs no locking:
+struct Recorder {
+	bool recording = false;
+	std::string filename;
+	glm::uvec2 size = glm::uvec2(0);
+	uint32_t max_frames = 0;
+
+	std::vector< uint8_t > commands;
+	std::vector< uint32_t > frame_ends;
+
+	//(buffer bindings and mappings are tracked so glUnmapBuffer knows what was written)
+	std::unordered_map< GLenum, GLuint > bound_buffers;
+	struct Mapping {
+		char const *data = nullptr;
+		GLsizeiptr length = 0;
+		GLbitfield access = 0;
+	};
+	std::unordered_map< GLuint, Mapping > mappings;
+
+	template< typename T >
+	void put(T const &value) {
+		size_t at = commands.size();
+		commands.resize(at + sizeof(T));
+		std::memcpy(&commands[at], &value, sizeof(T));
+	}
+	void put_bytes(void const *data, size_t size) {
+		put(uint32_t(size));
+		char const *bytes = reinterpret_cast< char const * >(data);
+		commands.insert(commands.end(), bytes, bytes + size);
+	}
+	//op, then each argument as its own type:
+	template< typename... Args >
+	void call(GLTraceOp op, Args... args) {
+		put(op);
+		int expand[] = { 0, (put(args), 0)... };
+		(void)expand;
+	}
+	void put_names(GLsizei n, GLuint const *names) {
+		put(n);
+		for (GLsizei i = 0; i < n; ++i) put(names[i]);
+	}
+	//fences are recorded by their address, which is unique while they exist:
+	static uint64_t sync_id(GLsync sync) {
+		return uint64_t(reinterpret_cast< uintptr_t >(sync));
+	}
+
+	void write() {
+		std::ofstream file(filename, std::ios::binary);
+		auto write_chunk = [](std::ostream &to, char const *magic, void const *data, uint32_t size) {
+			to.write(magic, 4);
+			to.write(reinterpret_cast< char const * >(&size), sizeof(size));
+			to.write(reinterpret_cast< char const * >(data), size);
+		};
+		uint32_t header[3] = { GLTraceVersion, size.x, size.y };
+		write_chunk(file, "gtr0", header, sizeof(header));
+		write_chunk(file, "cmd0", commands.data(), uint32_t(commands.size()));
+		write_chunk(file, "frm0", frame_ends.data(), uint32_t(frame_ends.size() * sizeof(uint32_t)));
+		if (!file) {
+			std::cerr << "WARNING: failed to write GL trace '" << filename << "'." << std::endl;
+		} else {
+			std::cout << "Wrote " << frame_ends.size() << " frames (" << commands.size() << " bytes of GL calls) to '" << filename << "'." << std::endl;
+		}
+	}
+};
+
+Recorder recorder;
+
+}
+
+void gl_trace_start(std::string const &filename, glm::uvec2 size, uint32_t max_frames) {
+	recorder = Recorder();
+	recorder.recording = true;
+	recorder.filename = filename;
+	recorder.size = size;
+	recorder.max_frames = max_frames;
+}
+
+void gl_trace_frame() {
+	if (!recorder.recording) return;
+	recorder.frame_ends.emplace_back(uint32_t(recorder.commands.size()));
+	//(chunk sizes are 32 bits, so very long traces stop early)
+	if (recorder.frame_ends.size() >= recorder.max_frames || recorder.commands.size() > 0x7fffffffU) {
+		gl_trace_stop();
+	}
+}
+
+void gl_trace_stop() {
+	if (!recorder.recording) return;
+	recorder.recording = false;
+	recorder.write();
+	recorder = Recorder();
+}
+
+//---- wrappers ----
+
+void trace_glAttachShader(GLuint program, GLuint shader) {
+	if (recorder.recording) recorder.call(GLTraceAttachShader, program, shader);
+	glAttachShader(program, shader);
+}
+
+void trace_glBeginQuery(GLenum target, GLuint id) {
+	if (recorder.recording) recorder.call(GLTraceBeginQuery, target, id);
+	glBeginQuery(target, id);
+}
+
+void trace_glBindBuffer(GLenum target, GLuint buffer) {
+	if (recorder.recording) {
+		recorder.call(GLTraceBindBuffer, target, buffer);
+		recorder.bound_buffers[target] = buffer;
+	}
+	glBindBuffer(target, buffer);
+}
+
+void trace_glBindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+	if (recorder.recording) {
+		recorder.call(GLTraceBindBufferBase, target, index, buffer);
+		//(indexed binds also bind the generic binding point)
+		recorder.bound_buffers[target] = buffer;
+	}
+	glBindBufferBase(target, index, buffer);
+}
+
+void trace_glBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+	if (recorder.recording) {
+		recorder.call(GLTraceBindBufferRange, target, index, buffer, offset, size);
+		recorder.bound_buffers[target] = buffer;
+	}
+	glBindBufferRange(target, index, buffer, offset, size);
+}
+
+void trace_glBindFramebuffer(GLenum target, GLuint framebuffer) {
+	if (recorder.recording) recorder.call(GLTraceBindFramebuffer, target, framebuffer);
+	glBindFramebuffer(target, framebuffer);
+}
+
+void trace_glBindRenderbuffer(GLenum target, GLuint renderbuffer) {
+	if (recorder.recording) recorder.call(GLTraceBindRenderbuffer, target, renderbuffer);
+	glBindRenderbuffer(target, renderbuffer);
+}
+
+void trace_glBindVertexArray(GLuint array) {
+	if (recorder.recording) recorder.call(GLTraceBindVertexArray, array);
+	glBindVertexArray(array);
+}
+
+void trace_glBlendFunc(GLenum sfactor, GLenum dfactor) {
+	if (recorder.recording) recorder.call(GLTraceBlendFunc, sfactor, dfactor);
+	glBlendFunc(sfactor, dfactor);
+}
+
+void trace_glBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter) {
+	if (recorder.recording) recorder.call(GLTraceBlitFramebuffer, srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+	glBlitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+}
+
+void trace_glBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage) {
+	if (recorder.recording) {
+		recorder.call(GLTraceBufferData, target, size, usage, uint8_t(data ? 1 : 0));
+		if (data) recorder.put_bytes(data, size_t(size));
+	}
+	glBufferData(target, size, data, usage);
+}
+
+void trace_glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data) {
+	if (recorder.recording) {
+		recorder.call(GLTraceBufferSubData, target, offset);
+		recorder.put_bytes(data, size_t(size));
+	}
+	glBufferSubData(target, offset, size, data);
+}
+
+void trace_glClear(GLbitfield mask) {
+	if (recorder.recording) recorder.call(GLTraceClear, mask);
+	glClear(mask);
+}
+
+void trace_glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+	if (recorder.recording) recorder.call(GLTraceClearColor, red, green, blue, alpha);
+	glClearColor(red, green, blue, alpha);
+}
+
+GLenum trace_glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+	GLenum result = glClientWaitSync(sync, flags, timeout);
+	if (recorder.recording) recorder.call(GLTraceClientWaitSync, Recorder::sync_id(sync), flags, timeout, result);
+	return result;
+}
+
+void trace_glCompileShader(GLuint shader) {
+	if (recorder.recording) recorder.call(GLTraceCompileShader, shader);
+	glCompileShader(shader);
+}
+
+GLuint trace_glCreateProgram() {
+	GLuint program = glCreateProgram();
+	if (recorder.recording) recorder.call(GLTraceCreateProgram, program);
+	return program;
+}
+
+GLuint trace_glCreateShader(GLenum type) {
+	GLuint shader = glCreateShader(type);
+	if (recorder.recording) recorder.call(GLTraceCreateShader, type, shader);
+	return shader;
+}
+
+void trace_glDeleteBuffers(GLsizei n, const GLuint *buffers) {
+	if (recorder.recording) {
+		recorder.put(GLTraceDeleteBuffers);
+		recorder.put_names(n, buffers);
+		for (GLsizei i = 0; i < n; ++i) recorder.mappings.erase(buffers[i]);
+	}
+	glDeleteBuffers(n, buffers);
+}
+
+void trace_glDeleteFramebuffers(GLsizei n, const GLuint *framebuffers) {
+	if (recorder.recording) {
+		recorder.put(GLTraceDeleteFramebuffers);
+		recorder.put_names(n, framebuffers);
+	}
+	glDeleteFramebuffers(n, framebuffers);
+}
+
+void trace_glDeleteProgram(GLuint program) {
+	if (recorder.recording) recorder.call(GLTraceDeleteProgram, program);
+	glDeleteProgram(program);
+}
+
+void trace_glDeleteQueries(GLsizei n, const GLuint *ids) {
+	if (recorder.recording) {
+		recorder.put(GLTraceDeleteQueries);
+		recorder.put_names(n, ids);
+	}
+	glDeleteQueries(n, ids);
+}
+
+void trace_glDeleteRenderbuffers(GLsizei n, const GLuint *renderbuffers) {
+	if (recorder.recording) {
+		recorder.put(GLTraceDeleteRenderbuffers);
+		recorder.put_names(n, renderbuffers);
+	}
+	glDeleteRenderbuffers(n, renderbuffers);
+}
+
+void trace_glDeleteShader(GLuint shader) {
+	if (recorder.recording) recorder.call(GLTraceDeleteShader, shader);
+	glDeleteShader(shader);
+}
+
+void trace_glDeleteSync(GLsync sync) {
+	if (recorder.recording) recorder.call(GLTraceDeleteSync, Recorder::sync_id(sync));
+	glDeleteSync(sync);
+}
+
+void trace_glDeleteVertexArrays(GLsizei n, const GLuint *arrays) {
+	if (recorder.recording) {
+		recorder.put(GLTraceDeleteVertexArrays);
+		recorder.put_names(n, arrays);
+	}
+	glDeleteVertexArrays(n, arrays);
+}
+
+void trace_glDepthMask(GLboolean flag) {
+	if (recorder.recording) recorder.call(GLTraceDepthMask, flag);
+	glDepthMask(flag);
+}
+
+void trace_glDisable(GLenum cap) {
+	if (recorder.recording) recorder.call(GLTraceDisable, cap);
+	glDisable(cap);
+}
+
+void trace_glDrawArrays(GLenum mode, GLint first, GLsizei count) {
+	if (recorder.recording) recorder.call(GLTraceDrawArrays, mode, first, count);
+	glDrawArrays(mode, first, count);
+}
+
+void trace_glEnable(GLenum cap) {
+	if (recorder.recording) recorder.call(GLTraceEnable, cap);
+	glEnable(cap);
+}
+
+void trace_glEnableVertexAttribArray(GLuint index) {
+	if (recorder.recording) recorder.call(GLTraceEnableVertexAttribArray, index);
+	glEnableVertexAttribArray(index);
+}
+
+void trace_glEndQuery(GLenum target) {
+	if (recorder.recording) recorder.call(GLTraceEndQuery, target);
+	glEndQuery(target);
+}
+
+GLsync trace_glFenceSync(GLenum condition, GLbitfield flags) {
+	GLsync sync = glFenceSync(condition, flags);
+	if (recorder.recording) recorder.call(GLTraceFenceSync, condition, flags, Recorder::sync_id(sync));
+	return sync;
+}
+
+void trace_glFinish() {
+	if (recorder.recording) recorder.call(GLTraceFinish);
+	glFinish();
+}
+
+void trace_glFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer) {
+	if (recorder.recording) recorder.call(GLTraceFramebufferRenderbuffer, target, attachment, renderbuffertarget, renderbuffer);
+	glFramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+}
+
+void trace_glGenBuffers(GLsizei n, GLuint *buffers) {
+	glGenBuffers(n, buffers);
+	if (recorder.recording) {
+		recorder.put(GLTraceGenBuffers);
+		recorder.put_names(n, buffers);
+	}
+}
+
+void trace_glGenFramebuffers(GLsizei n, GLuint *framebuffers) {
+	glGenFramebuffers(n, framebuffers);
+	if (recorder.recording) {
+		recorder.put(GLTraceGenFramebuffers);
+		recorder.put_names(n, framebuffers);
+	}
+}
+
+void trace_glGenQueries(GLsizei n, GLuint *ids) {
+	glGenQueries(n, ids);
+	if (recorder.recording) {
+		recorder.put(GLTraceGenQueries);
+		recorder.put_names(n, ids);
+	}
+}
+
+void trace_glGenRenderbuffers(GLsizei n, GLuint *renderbuffers) {
+	glGenRenderbuffers(n, renderbuffers);
+	if (recorder.recording) {
+		recorder.put(GLTraceGenRenderbuffers);
+		recorder.put_names(n, renderbuffers);
+	}
+}
+
+void trace_glGenVertexArrays(GLsizei n, GLuint *arrays) {
+	glGenVertexArrays(n, arrays);
+	if (recorder.recording) {
+		recorder.put(GLTraceGenVertexArrays);
+		recorder.put_names(n, arrays);
+	}
+}
+
+GLuint trace_glGetUniformBlockIndex(GLuint program, const GLchar *uniformBlockName) {
+	GLuint index = glGetUniformBlockIndex(program, uniformBlockName);
+	if (recorder.recording) {
+		recorder.call(GLTraceGetUniformBlockIndex, program, index);
+		recorder.put_bytes(uniformBlockName, std::strlen(uniformBlockName));
+	}
+	return index;
+}
+
+void trace_glLinkProgram(GLuint program) {
+	if (recorder.recording) recorder.call(GLTraceLinkProgram, program);
+	glLinkProgram(program);
+}
+
+void *trace_glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+	void *data = glMapBufferRange(target, offset, length, access);
+	if (recorder.recording && data) {
+		GLuint buffer = recorder.bound_buffers[target];
+		recorder.call(GLTraceMapBufferRange, target, offset, length, access, buffer);
+		Recorder::Mapping &mapping = recorder.mappings[buffer];
+		mapping.data = reinterpret_cast< char const * >(data);
+		mapping.length = length;
+		mapping.access = access;
+	}
+	return data;
+}
+
+void trace_glPixelStorei(GLenum pname, GLint param) {
+	if (recorder.recording) recorder.call(GLTracePixelStorei, pname, param);
+	glPixelStorei(pname, param);
+}
+
+void trace_glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void *pixels) {
+	if (recorder.recording) {
+		//(with a pixel pack buffer bound, 'pixels' is an offset into it; otherwise the replayer reads into scratch memory)
+		uint8_t to_buffer = (recorder.bound_buffers[GL_PIXEL_PACK_BUFFER] != 0 ? 1 : 0);
+		recorder.call(GLTraceReadPixels, x, y, width, height, format, type, to_buffer, uint64_t(reinterpret_cast< uintptr_t >(pixels)));
+	}
+	glReadPixels(x, y, width, height, format, type, pixels);
+}
+
+void trace_glRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height) {
+	if (recorder.recording) recorder.call(GLTraceRenderbufferStorage, target, internalformat, width, height);
+	glRenderbufferStorage(target, internalformat, width, height);
+}
+
+void trace_glShaderSource(GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length) {
+	if (recorder.recording) {
+		std::string source;
+		for (GLsizei i = 0; i < count; ++i) {
+			if (length && length[i] >= 0) source.append(string[i], length[i]);
+			else source.append(string[i]);
+		}
+		recorder.call(GLTraceShaderSource, shader);
+		recorder.put_bytes(source.data(), source.size());
+	}
+	glShaderSource(shader, count, string, length);
+}
+
+void trace_glUniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding) {
+	if (recorder.recording) recorder.call(GLTraceUniformBlockBinding, program, uniformBlockIndex, uniformBlockBinding);
+	glUniformBlockBinding(program, uniformBlockIndex, uniformBlockBinding);
+}
+
+GLboolean trace_glUnmapBuffer(GLenum target) {
+	if (recorder.recording) {
+		GLuint buffer = recorder.bound_buffers[target];
+		recorder.call(GLTraceUnmapBuffer, target, buffer);
+		//whatever the game wrote into the mapping is the payload:
+		auto f = recorder.mappings.find(buffer);
+		if (f != recorder.mappings.end() && (f->second.access & GL_MAP_WRITE_BIT)) {
+			recorder.put_bytes(f->second.data, size_t(f->second.length));
+		} else {
+			recorder.put_bytes(nullptr, 0);
+		}
+		if (f != recorder.mappings.end()) recorder.mappings.erase(f);
+	}
+	return glUnmapBuffer(target);
+}
+
+void trace_glUseProgram(GLuint program) {
+	if (recorder.recording) recorder.call(GLTraceUseProgram, program);
+	glUseProgram(program);
+}
+
+void trace_glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer) {
+	//(attributes always come from buffers, so the pointer is an offset)
+	if (recorder.recording) recorder.call(GLTraceVertexAttribPointer, index, size, type, normalized, stride, uint64_t(reinterpret_cast< uintptr_t >(pointer)));
+	glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+}
+
+void trace_glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+	if (recorder.recording) recorder.call(GLTraceViewport, x, y, width, height);
+	glViewport(x, y, width, height);
+}
+
+#endif //GL_TRACE
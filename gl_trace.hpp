@@ -0,0 +1,214 @@
+#pragma once
+
+//GL call tracing: builds made with 'jam -sGL_TRACE=1' can record the GL calls
+// the game makes (plus the buffer contents and shader sources they pass along)
+// to a compact binary trace, which 'dist/gl-replay' re-issues in a loop and times.
+// So a slow frame can be reproduced -- and renderer or driver changes compared on
+// exactly the same work -- without the level or input that produced it.
+//
+//   dist/main --trace slow.gltrace --trace-frames 300
+//   dist/gl-replay slow.gltrace --frames 120:180 --loops 50
+//
+//Tracing works by redirecting each GL entry point the game uses (see the list
+// at the bottom of this file) to a trace_gl* wrapper, which records the call
+// and then makes it. Queries (glGet*, glCheckFramebufferStatus) aren't recorded,
+// since replaying them would only add stalls. Things to know:
+// - buffer contents written through glMapBufferRange are recorded at glUnmapBuffer,
+//   so GL_TRACE builds don't use persistent mappings (see StreamBuffer);
+// - program binaries are driver-specific, so GL_TRACE builds don't use the
+//   program binary cache (see ShaderManager);
+// - object names and fences are remapped by the replayer, and framebuffer 0 (or
+//   any framebuffer made before recording started) is replaced by an offscreen
+//   framebuffer of the recorded size.
+//
+//Trace files are three chunks (see read_chunk.hpp):
+//  'gtr0' -- header: uint32_t version, width, height
+//  'cmd0' -- the calls: a GLTraceOp byte, then the arguments as their GL types,
+//            then (for some calls) a uint32_t byte count and that many bytes
+//  'frm0' -- uint32_t offset into 'cmd0' of the end of each frame
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+
+enum GLTraceOp : uint8_t {
+	GLTraceAttachShader = 1,
+	GLTraceBeginQuery,
+	GLTraceBindBuffer,
+	GLTraceBindBufferBase,
+	GLTraceBindBufferRange,
+	GLTraceBindFramebuffer,
+	GLTraceBindRenderbuffer,
+	GLTraceBindVertexArray,
+	GLTraceBlendFunc,
+	GLTraceBlitFramebuffer,
+	GLTraceBufferData, //+ payload (if data was given)
+	GLTraceBufferSubData, //+ payload
+	GLTraceClear,
+	GLTraceClearColor,
+	GLTraceClientWaitSync, //(records the result, so the replay waits wherever the game did)
+	GLTraceCompileShader,
+	GLTraceCreateProgram,
+	GLTraceCreateShader,
+	GLTraceDeleteBuffers,
+	GLTraceDeleteFramebuffers,
+	GLTraceDeleteProgram,
+	GLTraceDeleteQueries,
+	GLTraceDeleteRenderbuffers,
+	GLTraceDeleteShader,
+	GLTraceDeleteSync,
+	GLTraceDeleteVertexArrays,
+	GLTraceDepthMask,
+	GLTraceDisable,
+	GLTraceDrawArrays,
+	GLTraceEnable,
+	GLTraceEnableVertexAttribArray,
+	GLTraceEndQuery,
+	GLTraceFenceSync,
+	GLTraceFinish,
+	GLTraceFramebufferRenderbuffer,
+	GLTraceGenBuffers,
+	GLTraceGenFramebuffers,
+	GLTraceGenQueries,
+	GLTraceGenRenderbuffers,
+	GLTraceGenVertexArrays,
+	GLTraceGetUniformBlockIndex, //+ payload (block name); the result is remapped for glUniformBlockBinding
+	GLTraceLinkProgram,
+	GLTraceMapBufferRange,
+	GLTracePixelStorei,
+	GLTraceReadPixels,
+	GLTraceRenderbufferStorage,
+	GLTraceShaderSource, //+ payload (all the strings, concatenated)
+	GLTraceUniformBlockBinding,
+	GLTraceUnmapBuffer, //+ payload (what was written to the mapping, if it was mapped for writing)
+	GLTraceUseProgram,
+	GLTraceVertexAttribPointer,
+	GLTraceViewport,
+	GLTraceOpCount
+};
+
+const uint32_t GLTraceVersion = 1;
+
+#ifdef GL_TRACE
+
+//start recording every GL call (call once the context exists; 'size' is the window's drawable size):
+void gl_trace_start(std::string const &filename, glm::uvec2 size, uint32_t max_frames);
+//mark the end of a frame (after the swap); writes the trace once max_frames have been recorded:
+void gl_trace_frame();
+//write the trace now (if still recording); safe to call more than once:
+void gl_trace_stop();
+
+//the wrappers themselves:
+void trace_glAttachShader(GLuint program, GLuint shader);
+void trace_glBeginQuery(GLenum target, GLuint id);
+void trace_glBindBuffer(GLenum target, GLuint buffer);
+void trace_glBindBufferBase(GLenum target, GLuint index, GLuint buffer);
+void trace_glBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+void trace_glBindFramebuffer(GLenum target, GLuint framebuffer);
+void trace_glBindRenderbuffer(GLenum target, GLuint renderbuffer);
+void trace_glBindVertexArray(GLuint array);
+void trace_glBlendFunc(GLenum sfactor, GLenum dfactor);
+void trace_glBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter);
+void trace_glBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+void trace_glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data);
+void trace_glClear(GLbitfield mask);
+void trace_glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+GLenum trace_glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout);
+void trace_glCompileShader(GLuint shader);
+GLuint trace_glCreateProgram();
+GLuint trace_glCreateShader(GLenum type);
+void trace_glDeleteBuffers(GLsizei n, const GLuint *buffers);
+void trace_glDeleteFramebuffers(GLsizei n, const GLuint *framebuffers);
+void trace_glDeleteProgram(GLuint program);
+void trace_glDeleteQueries(GLsizei n, const GLuint *ids);
+void trace_glDeleteRenderbuffers(GLsizei n, const GLuint *renderbuffers);
+void trace_glDeleteShader(GLuint shader);
+void trace_glDeleteSync(GLsync sync);
+void trace_glDeleteVertexArrays(GLsizei n, const GLuint *arrays);
+void trace_glDepthMask(GLboolean flag);
+void trace_glDisable(GLenum cap);
+void trace_glDrawArrays(GLenum mode, GLint first, GLsizei count);
+void trace_glEnable(GLenum cap);
+void trace_glEnableVertexAttribArray(GLuint index);
+void trace_glEndQuery(GLenum target);
+GLsync trace_glFenceSync(GLenum condition, GLbitfield flags);
+void trace_glFinish();
+void trace_glFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer);
+void trace_glGenBuffers(GLsizei n, GLuint *buffers);
+void trace_glGenFramebuffers(GLsizei n, GLuint *framebuffers);
+void trace_glGenQueries(GLsizei n, GLuint *ids);
+void trace_glGenRenderbuffers(GLsizei n, GLuint *renderbuffers);
+void trace_glGenVertexArrays(GLsizei n, GLuint *arrays);
+GLuint trace_glGetUniformBlockIndex(GLuint program, const GLchar *uniformBlockName);
+void trace_glLinkProgram(GLuint program);
+void *trace_glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+void trace_glPixelStorei(GLenum pname, GLint param);
+void trace_glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void *pixels);
+void trace_glRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height);
+void trace_glShaderSource(GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length);
+void trace_glUniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding);
+GLboolean trace_glUnmapBuffer(GLenum target);
+void trace_glUseProgram(GLuint program);
+void trace_glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer);
+void trace_glViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+//gl_trace.cpp (which calls the real entry points) and the replayer define GL_TRACE_NO_REDIRECT:
+#ifndef GL_TRACE_NO_REDIRECT
+#define glAttachShader trace_glAttachShader
+#define glBeginQuery trace_glBeginQuery
+#define glBindBuffer trace_glBindBuffer
+#define glBindBufferBase trace_glBindBufferBase
+#define glBindBufferRange trace_glBindBufferRange
+#define glBindFramebuffer trace_glBindFramebuffer
+#define glBindRenderbuffer trace_glBindRenderbuffer
+#define glBindVertexArray trace_glBindVertexArray
+#define glBlendFunc trace_glBlendFunc
+#define glBlitFramebuffer trace_glBlitFramebuffer
+#define glBufferData trace_glBufferData
+#define glBufferSubData trace_glBufferSubData
+#define glClear trace_glClear
+#define glClearColor trace_glClearColor
+#define glClientWaitSync trace_glClientWaitSync
+#define glCompileShader trace_glCompileShader
+#define glCreateProgram trace_glCreateProgram
+#define glCreateShader trace_glCreateShader
+#define glDeleteBuffers trace_glDeleteBuffers
+#define glDeleteFramebuffers trace_glDeleteFramebuffers
+#define glDeleteProgram trace_glDeleteProgram
+#define glDeleteQueries trace_glDeleteQueries
+#define glDeleteRenderbuffers trace_glDeleteRenderbuffers
+#define glDeleteShader trace_glDeleteShader
+#define glDeleteSync trace_glDeleteSync
+#define glDeleteVertexArrays trace_glDeleteVertexArrays
+#define glDepthMask trace_glDepthMask
+#define glDisable trace_glDisable
+#define glDrawArrays trace_glDrawArrays
+#define glEnable trace_glEnable
+#define glEnableVertexAttribArray trace_glEnableVertexAttribArray
+#define glEndQuery trace_glEndQuery
+#define glFenceSync trace_glFenceSync
+#define glFinish trace_glFinish
+#define glFramebufferRenderbuffer trace_glFramebufferRenderbuffer
+#define glGenBuffers trace_glGenBuffers
+#define glGenFramebuffers trace_glGenFramebuffers
+#define glGenQueries trace_glGenQueries
+#define glGenRenderbuffers trace_glGenRenderbuffers
+#define glGenVertexArrays trace_glGenVertexArrays
+#define glGetUniformBlockIndex trace_glGetUniformBlockIndex
+#define glLinkProgram trace_glLinkProgram
+#define glMapBufferRange trace_glMapBufferRange
+#define glPixelStorei trace_glPixelStorei
+#define glReadPixels trace_glReadPixels
+#define glRenderbufferStorage trace_glRenderbufferStorage
+#define glShaderSource trace_glShaderSource
+#define glUniformBlockBinding trace_glUniformBlockBinding
+#define glUnmapBuffer trace_glUnmapBuffer
+#define glUseProgram trace_glUseProgram
+#define glVertexAttribPointer trace_glVertexAttribPointer
+#define glViewport trace_glViewport
+#endif //GL_TRACE_NO_REDIRECT
+
+#endif //GL_TRACE
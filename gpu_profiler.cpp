@@ -0,0 +1,136 @@
+#include "gpu_profiler.hpp"
+
+#include "sample_stats.hpp"
+
+#include <iomanip>
+#include <vector>
+
+GPUProfiler::GPUProfiler() {
+	for (uint32_t i = 0; i < FramesInFlight; ++i) {
+		frame_sums[i] = 0.0f;
+		frame_parts[i] = 0;
+	}
+}
+
+GPUProfiler::~GPUProfiler() {
+	for (uint32_t s = 0; s < section_count; ++s) {
+		glDeleteQueries(FramesInFlight * MaxRuns, &sections[s].queries[0][0]);
+	}
+}
+
+void GPUProfiler::History::push(float ms) {
+	samples[next] = ms;
+	next = (next + 1) % HistorySize;
+	if (count < HistorySize) ++count;
+}
+
+void GPUProfiler::begin_frame() {
+	slot = (slot + 1) % FramesInFlight;
+
+	//the queries in this slot were issued FramesInFlight frames ago:
+	bool complete = (frame_parts[slot] > 0);
+	for (uint32_t s = 0; s < section_count; ++s) {
+		Section &section = sections[s];
+		uint32_t runs = section.runs[slot];
+		if (runs == 0) continue;
+		section.runs[slot] = 0;
+
+		bool available = true;
+		for (uint32_t r = 0; r < runs && available; ++r) {
+			GLint run_available = GL_FALSE;
+			glGetQueryObjectiv(section.queries[slot][r], GL_QUERY_RESULT_AVAILABLE, &run_available);
+			available = (run_available == GL_TRUE);
+		}
+		if (!available) {
+			++dropped;
+			complete = false;
+			continue;
+		}
+		//(a section's runs add up to its time for the frame)
+		float ms = 0.0f;
+		for (uint32_t r = 0; r < runs; ++r) {
+			GLuint64 ns = 0;
+			glGetQueryObjectui64v(section.queries[slot][r], GL_QUERY_RESULT, &ns);
+			ms += float(ns) / 1.0e6f;
+		}
+		section.history.push(ms);
+		frame_sums[slot] += ms;
+	}
+	if (complete) {
+		latest_frame_ms = frame_sums[slot];
+		frame_history.push(latest_frame_ms);
+	}
+	frame_sums[slot] = 0.0f;
+	frame_parts[slot] = 0;
+}
+
+void GPUProfiler::begin(char const *name) {
+	if (active) {
+		std::cerr << "WARNING: GPU profiler section '" << name << "' started inside '" << active->name << "'; ignoring." << std::endl;
+		return;
+	}
+	Section *section = nullptr;
+	for (uint32_t s = 0; s < section_count; ++s) {
+		if (sections[s].name == name) {
+			section = &sections[s];
+			break;
+		}
+	}
+	if (!section) {
+		if (section_count == MaxSections) return;
+		section = &sections[section_count++];
+		section->name = name;
+		glGenQueries(FramesInFlight * MaxRuns, &section->queries[0][0]);
+		for (uint32_t i = 0; i < FramesInFlight; ++i) {
+			section->runs[i] = 0;
+		}
+	}
+	uint32_t &runs = section->runs[slot];
+	if (runs == MaxRuns) {
+		if (!section->warned) {
+			std::cerr << "WARNING: GPU profiler section '" << name << "' began more than " << int(MaxRuns) << " times in a frame; its later runs aren't timed." << std::endl;
+			section->warned = true;
+		}
+		return;
+	}
+
+	glBeginQuery(GL_TIME_ELAPSED, section->queries[slot][runs]);
+	++runs;
+	++frame_parts[slot];
+	active = section;
+}
+
+void GPUProfiler::end() {
+	if (!active) return;
+	glEndQuery(GL_TIME_ELAPSED);
+	active = nullptr;
+}
+
+void GPUProfiler::end_frame() {
+	end();
+}
+
+void GPUProfiler::report(std::ostream &out) const {
+	auto print = [&out](char const *name, History const &history) {
+		if (history.count == 0) return;
+		SampleStats stats = summarize(std::vector< float >(history.samples, history.samples + history.count));
+		out << "  " << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(3)
+			<< " mean " << std::setw(7) << stats.mean
+			<< "  p50 " << std::setw(7) << stats.p50
+			<< "  p95 " << std::setw(7) << stats.p95
+			<< "  p99 " << std::setw(7) << stats.p99
+			<< "  max " << std::setw(7) << stats.max
+			<< "  (" << stats.count << " frames)" << std::endl;
+	};
+
+	out << "GPU time per frame (ms):" << std::endl;
+	for (uint32_t s = 0; s < section_count; ++s) {
+		print(sections[s].name, sections[s].history);
+	}
+	print("total", frame_history);
+	if (dropped) {
+		out << "  (" << dropped << " results dropped because they were not ready in time)" << std::endl;
+	}
+	out.unsetf(std::ios::floatfield);
+	out << std::setprecision(6);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <cstdint>
+#include <iostream>
+
+//GPUProfiler measures GPU time spent in sections of a frame with GL_TIME_ELAPSED queries:
+//   profiler.begin_frame();
+//   profiler.begin("walls"); ...draw walls...; profiler.end();
+//   profiler.begin("floor"); ...draw floor...; profiler.end();
+//   profiler.end_frame();
+//
+//Queries are kept in a ring FramesInFlight deep and read back that many frames
+// later, so reading results never stalls the pipeline (a result that still isn't
+// ready is dropped rather than waited on). Sections can't nest, but one may be
+// begun several times a frame (e.g., once per run of a mesh): its times are added
+// up, for up to MaxRuns runs a frame.
+//
+//The last HistorySize samples of each section (and of the frame total) are kept,
+// and report() prints their mean and percentiles.
+struct GPUProfiler {
+	enum {
+		FramesInFlight = 4,
+		HistorySize = 512,
+		MaxSections = 16,
+		MaxRuns = 8, //times a section may be begun in one frame
+	};
+
+	GPUProfiler();
+	~GPUProfiler();
+
+	GPUProfiler(GPUProfiler const &) = delete;
+	GPUProfiler &operator=(GPUProfiler const &) = delete;
+
+	//collects finished results from FramesInFlight frames ago:
+	void begin_frame();
+	//'name' must be a string literal (sections are identified by pointer):
+	void begin(char const *name);
+	void end();
+	void end_frame();
+
+	//print per-section mean/p50/p95/p99/max GPU times:
+	void report(std::ostream &out) const;
+
+	//most recent GPU time of a whole frame (0 until results arrive):
+	float latest_frame_ms = 0.0f;
+
+	uint32_t dropped = 0; //results that weren't ready after FramesInFlight frames
+
+private:
+	struct History {
+		float samples[HistorySize];
+		uint32_t count = 0; //samples recorded (saturates at HistorySize)
+		uint32_t next = 0; //where the next sample goes
+		void push(float ms);
+	};
+	struct Section {
+		char const *name = nullptr;
+		GLuint queries[FramesInFlight][MaxRuns];
+		uint32_t runs[FramesInFlight]; //queries issued in each slot's frame
+		History history;
+		bool warned = false; //(about running out of runs)
+	};
+	Section sections[MaxSections];
+	uint32_t section_count = 0;
+	History frame_history;
+	float frame_sums[FramesInFlight];
+	uint32_t frame_parts[FramesInFlight]; //results still to arrive for each slot's frame
+
+	uint32_t slot = 0; //ring slot of the current frame
+	Section *active = nullptr;
+};
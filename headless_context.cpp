@@ -0,0 +1,145 @@
+#include "headless_context.hpp"
+
+#ifndef GL_MOCK
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#ifndef GL_MOCK
+static bool has_extension(char const *extensions, char const *name) {
+	if (!extensions) return false;
+	size_t len = std::strlen(name);
+	for (char const *at = std::strstr(extensions, name); at; at = std::strstr(at + len, name)) {
+		//(make sure this is a whole word, not a prefix of some other extension)
+		if ((at == extensions || at[-1] == ' ') && (at[len] == ' ' || at[len] == '\0')) return true;
+	}
+	return false;
+}
+#endif //GL_MOCK
+
+HeadlessContext::HeadlessContext(glm::uvec2 size_) : size(size_) {
+	#ifdef GL_MOCK
+	//(mock GL needs no context; the framebuffer below is only made so the calls get counted)
+	std::cout << "Mock OpenGL: no context; GL calls are counted, not made." << std::endl;
+	#else
+	//prefer Mesa's surfaceless platform (needs no display server at all):
+	EGLDisplay egl_display = EGL_NO_DISPLAY;
+	char const *client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	if (has_extension(client_extensions, "EGL_MESA_platform_surfaceless")) {
+		PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (get_platform_display) {
+			egl_display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		}
+	}
+	if (egl_display == EGL_NO_DISPLAY) {
+		egl_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+	EGLint major = 0, minor = 0;
+	if (egl_display == EGL_NO_DISPLAY || !eglInitialize(egl_display, &major, &minor)) {
+		throw std::runtime_error("HeadlessContext: failed to initialize an EGL display.");
+	}
+	display = egl_display;
+
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		throw std::runtime_error("HeadlessContext: EGL display doesn't support desktop OpenGL.");
+	}
+
+	//without surfaceless contexts, a 1x1 pbuffer stands in for the (unused) default framebuffer:
+	surfaceless = has_extension(eglQueryString(egl_display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+
+	EGLint config_attribs[] = {
+		EGL_SURFACE_TYPE, (surfaceless ? 0 : EGL_PBUFFER_BIT),
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_NONE
+	};
+	EGLConfig config = nullptr;
+	EGLint config_count = 0;
+	if (!eglChooseConfig(egl_display, config_attribs, &config, 1, &config_count) || config_count < 1) {
+		throw std::runtime_error("HeadlessContext: no suitable EGL config.");
+	}
+
+	EGLint context_attribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext egl_context = eglCreateContext(egl_display, config, EGL_NO_CONTEXT, context_attribs);
+	if (egl_context == EGL_NO_CONTEXT) {
+		throw std::runtime_error("HeadlessContext: failed to create an OpenGL 3.3 core context.");
+	}
+	context = egl_context;
+
+	EGLSurface egl_surface = EGL_NO_SURFACE;
+	if (!surfaceless) {
+		EGLint pbuffer_attribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		egl_surface = eglCreatePbufferSurface(egl_display, config, pbuffer_attribs);
+		if (egl_surface == EGL_NO_SURFACE) {
+			throw std::runtime_error("HeadlessContext: failed to create pbuffer surface.");
+		}
+		surface = egl_surface;
+	}
+
+	if (!eglMakeCurrent(egl_display, egl_surface, egl_surface, egl_context)) {
+		throw std::runtime_error("HeadlessContext: failed to make context current.");
+	}
+
+	std::cout << "Headless OpenGL " << glGetString(GL_VERSION) << " on " << glGetString(GL_RENDERER)
+		<< " (EGL " << major << "." << minor << (surfaceless ? ", surfaceless" : ", pbuffer") << ")." << std::endl;
+	#endif //GL_MOCK
+
+	//framebuffer to render into:
+	glGenRenderbuffers(1, &color_renderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, color_renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size.x, size.y);
+
+	glGenRenderbuffers(1, &depth_renderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth_renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, size.x, size.y);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_renderbuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth_renderbuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		throw std::runtime_error("HeadlessContext: framebuffer is incomplete.");
+	}
+
+	bind();
+}
+
+HeadlessContext::~HeadlessContext() {
+	if (framebuffer) glDeleteFramebuffers(1, &framebuffer);
+	if (color_renderbuffer) glDeleteRenderbuffers(1, &color_renderbuffer);
+	if (depth_renderbuffer) glDeleteRenderbuffers(1, &depth_renderbuffer);
+
+	#ifndef GL_MOCK
+	EGLDisplay egl_display = (EGLDisplay)display;
+	eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (surface) eglDestroySurface(egl_display, (EGLSurface)surface);
+	if (context) eglDestroyContext(egl_display, (EGLContext)context);
+	eglTerminate(egl_display);
+	#endif
+}
+
+void HeadlessContext::bind() {
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, size.x, size.y);
+}
+
+void HeadlessContext::read_pixels(std::vector< uint8_t > *rgba) {
+	rgba->resize(size_t(size.x) * size.y * 4);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, rgba->data());
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+//HeadlessContext creates an OpenGL 3.3 core context without a window or a
+// display server (through EGL: surfaceless if the driver supports it, otherwise
+// with a tiny pbuffer), plus a framebuffer object to render into:
+//   HeadlessContext headless(glm::uvec2(1280, 720));
+//   headless.bind(); ...draw...
+//   headless.read_pixels(&rgba);
+//This works with software rasterizers (e.g., Mesa's llvmpipe), so rendering can
+// be benchmarked on machines with no GPU. Constructor throws on failure.
+//
+//In mock GL builds (see gl_mock.hpp) no context is created at all.
+//
+//SDL isn't initialized in this mode, so code that asks SDL about extensions
+// (parallel compile, program binaries, buffer storage) takes its fallback paths.
+struct HeadlessContext {
+	explicit HeadlessContext(glm::uvec2 size);
+	~HeadlessContext();
+
+	HeadlessContext(HeadlessContext const &) = delete;
+	HeadlessContext &operator=(HeadlessContext const &) = delete;
+
+	//bind the framebuffer and set the viewport to cover it:
+	void bind();
+
+	//read the framebuffer back as RGBA8 (bottom row first):
+	void read_pixels(std::vector< uint8_t > *rgba);
+
+	glm::uvec2 size;
+
+	GLuint framebuffer = 0;
+	GLuint color_renderbuffer = 0;
+	GLuint depth_renderbuffer = 0;
+
+	//(EGL handles, kept opaque so EGL headers don't leak into every file)
+	void *display = nullptr;
+	void *context = nullptr;
+	void *surface = nullptr;
+	bool surfaceless = false;
+};
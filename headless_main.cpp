@@ -0,0 +1,293 @@
+//headless_main.cpp is a second entry point ('dist/headless', Linux only) that
+// runs the same benchmark as 'main --bench', but renders offscreen through an
+// EGL context -- so render performance can be measured on machines with no
+// display (and, with a software rasterizer, no GPU).
+
+#include "Game.hpp"
+#include "GL.hpp"
+#include "gl_state.hpp"
+#include "gl_errors.hpp"
+#include "headless_context.hpp"
+#include "png_io.hpp"
+#include "bench.hpp"
+#include "gl_mock.hpp"
+#include "cpu_profiler.hpp"
+#include "perf_hud.hpp"
+#include "alloc_tracker.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static int run(int argc, char **argv) {
+	struct {
+		glm::uvec2 size = glm::uvec2(1280, 720);
+		std::string level = "level1.map";
+		uint32_t frames = 1000;
+		uint32_t warmup = 30; //frames not counted (shader compiles, cold caches)
+		std::string replay_file = ""; //input, instead of the script
+		std::string json_file = ""; //write the report as JSON here (otherwise to stdout)
+		std::string png_prefix = ""; //if set, every frame is saved as <prefix>NNNNNN.png
+		std::string trace = ""; //record GL calls for dist/gl-replay (needs 'jam -sGL_TRACE=1')
+		uint32_t trace_frames = 300;
+		//fail if any counted frame makes more GL calls than this (needs 'jam -sGL_MOCK=1'; 0 = no limit):
+		uint32_t max_gl_calls = 0;
+		std::string profile = ""; //write CPU scopes (see cpu_profiler.hpp) here as Chrome trace JSON
+		bool hud = false; //draw the performance overlay (as F1 does in dist/main), and report what it cost
+		bool alloc_stats = false; //count heap allocations per frame (see alloc_tracker.hpp) and report them
+		bool zero_allocs = false; //fail if Game::update or Game::draw allocates in any counted frame
+	} config;
+
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--size" && argi + 1 < argc) {
+			unsigned int w = 0, h = 0;
+			if (std::sscanf(argv[++argi], "%ux%u", &w, &h) != 2 || w == 0 || h == 0) {
+				std::cerr << "Expecting --size WIDTHxHEIGHT." << std::endl;
+				return 1;
+			}
+			config.size = glm::uvec2(w, h);
+		} else if (arg == "--bench" && argi + 1 < argc) {
+			config.level = argv[++argi];
+		} else if (arg == "--frames" && argi + 1 < argc) {
+			config.frames = std::stoul(argv[++argi]);
+		} else if (arg == "--replay" && argi + 1 < argc) {
+			config.replay_file = argv[++argi];
+		} else if (arg == "--json" && argi + 1 < argc) {
+			config.json_file = argv[++argi];
+		} else if (arg == "--png" && argi + 1 < argc) {
+			config.png_prefix = argv[++argi];
+		} else if (arg == "--trace" && argi + 1 < argc) {
+			config.trace = argv[++argi];
+		} else if (arg == "--trace-frames" && argi + 1 < argc) {
+			config.trace_frames = std::stoul(argv[++argi]);
+		} else if (arg == "--max-gl-calls" && argi + 1 < argc) {
+			config.max_gl_calls = std::stoul(argv[++argi]);
+		} else if (arg == "--profile" && argi + 1 < argc) {
+			config.profile = argv[++argi];
+		} else if (arg == "--hud") {
+			config.hud = true;
+		} else if (arg == "--alloc-stats") {
+			config.alloc_stats = true;
+		} else if (arg == "--zero-allocs") {
+			config.alloc_stats = true;
+			config.zero_allocs = true;
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--size 1280x720] [--bench level1.map] [--frames N] [--replay input.bin] [--json report.json] [--png frames/] [--trace calls.gltrace [--trace-frames 300]] [--max-gl-calls N] [--profile trace.json] [--hud] [--alloc-stats] [--zero-allocs]" << std::endl;
+			return 1;
+		}
+	}
+
+	InputTrack input = (config.replay_file != ""
+		? InputTrack::load(config.replay_file)
+		: InputTrack::scripted(config.warmup + config.frames));
+	if (input.level != "" && input.level != config.level) {
+		std::cerr << "'" << config.replay_file << "' was recorded on level '" << input.level << "', not '" << config.level << "'." << std::endl;
+		return 1;
+	}
+
+	#ifndef GL_TRACE
+	if (config.trace != "") {
+		std::cerr << "--trace needs a build with GL tracing ('jam -sGL_TRACE=1')." << std::endl;
+		return 1;
+	}
+	#endif
+	#ifndef GL_MOCK
+	if (config.max_gl_calls != 0) {
+		std::cerr << "--max-gl-calls needs a mock GL build ('jam -sGL_MOCK=1')." << std::endl;
+		return 1;
+	}
+	#endif
+
+	if (config.profile != "") {
+		cpu_profiler_enable(true);
+		cpu_profiler_thread_name("main");
+	}
+	if (config.alloc_stats) alloc_tracker_enable(true);
+
+	std::unique_ptr< HeadlessContext > headless(new HeadlessContext(config.size));
+
+	#ifdef GL_TRACE
+	//(the context's framebuffer is made before recording starts, so the replayer substitutes its own)
+	if (config.trace != "") gl_trace_start(config.trace, config.size, config.trace_frames);
+	#endif
+
+	std::unique_ptr< Game > game(new Game());
+	//(guards pick directions with std::rand)
+	std::srand(1);
+	if (!game->select_level(config.level)) {
+		std::cerr << "Unknown level '" << config.level << "'." << std::endl;
+		return 1;
+	}
+
+	typedef std::chrono::high_resolution_clock Clock;
+	auto ms_between = [](Clock::time_point a, Clock::time_point b) {
+		return std::chrono::duration< float, std::milli >(b - a).count();
+	};
+
+	std::unique_ptr< PerfHUD > hud;
+	if (config.hud) hud.reset(new PerfHUD());
+	double hud_ms = 0.0; //(CPU time in counted frames)
+
+	BenchTimings timings;
+	timings.reserve(config.frames);
+	std::vector< uint8_t > pixels;
+
+	for (uint32_t frame = 0; frame < config.warmup + config.frames; ++frame) {
+		PROFILE_SCOPE("frame");
+		Clock::time_point update_begin = Clock::now();
+
+		game->set_controls(input.at(frame));
+		game->update(InputTrackStep);
+
+		Clock::time_point draw_begin = Clock::now();
+
+		headless->bind();
+		gl_state().clear_color(0.5f, 0.5f, 0.5f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		gl_state().set_enabled(GL_DEPTH_TEST, true);
+		gl_state().set_enabled(GL_BLEND, true);
+		gl_state().blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+		game->draw(config.size);
+		if (hud) {
+			hud->draw(config.size);
+			if (frame >= config.warmup) hud_ms += hud->draw_cpu_ms;
+		}
+
+		//with no swap, "swap" time is waiting for the frame to finish rendering:
+		Clock::time_point swap_begin = Clock::now();
+		{
+			PROFILE_SCOPE("swap");
+			glFinish();
+		}
+		Clock::time_point frame_end = Clock::now();
+
+		gl_state().end_frame();
+
+		#ifdef GL_TRACE
+		gl_trace_frame();
+		#endif
+
+		#ifdef GL_MOCK
+		gl_mock().end_frame();
+		if (frame + 1 == config.warmup) gl_mock().clear(); //(warm-up frames aren't counted)
+		#endif
+
+		if (config.alloc_stats) {
+			alloc_tracker().end_frame();
+			if (frame + 1 == config.warmup) alloc_tracker().clear(); //(warm-up frames aren't counted)
+		}
+
+		if (hud) {
+			PerfHUD::Frame stats;
+			stats.frame_ms = ms_between(update_begin, frame_end);
+			stats.update_ms = ms_between(update_begin, draw_begin);
+			stats.draw_ms = ms_between(draw_begin, swap_begin);
+			stats.swap_ms = ms_between(swap_begin, frame_end);
+			stats.gpu_ms = game->gpu_profiler.latest_frame_ms;
+			stats.draws = game->draw_stats.draws;
+			stats.triangles = game->draw_stats.triangles;
+			stats.guards = game->draw_stats.guards;
+			stats.walls = game->draw_stats.walls;
+			hud->add_frame(stats);
+		}
+
+		if (frame >= config.warmup) {
+			timings.add(
+				ms_between(update_begin, draw_begin),
+				ms_between(draw_begin, swap_begin),
+				ms_between(swap_begin, frame_end),
+				ms_between(update_begin, frame_end)
+			);
+		}
+
+		if (config.png_prefix != "") {
+			headless->read_pixels(&pixels);
+			char number[16];
+			std::snprintf(number, sizeof(number), "%06u", frame);
+			save_png(config.png_prefix + number + ".png", config.size.x, config.size.y, pixels.data(), true);
+		}
+	}
+
+	GL_ERRORS();
+
+	#ifdef GL_TRACE
+	gl_trace_stop();
+	#endif
+
+	game.reset();
+	gl_state().report(std::cout);
+	if (hud) {
+		std::cout << "HUD: " << hud_ms / std::max(1U, config.frames) << "ms CPU per frame." << std::endl;
+		hud.reset();
+	}
+
+	std::cout << "Rendered " << config.size.x << "x" << config.size.y << " offscreen; 'swap' is glFinish." << std::endl;
+	timings.report(std::cout);
+	std::string input_name = (config.replay_file != "" ? config.replay_file : "scripted");
+	if (config.json_file != "") {
+		std::ofstream json(config.json_file);
+		timings.report_json(json, config.level, uint32_t(timings.frame_ms.size()), config.warmup, input_name);
+	} else {
+		timings.report_json(std::cout, config.level, uint32_t(timings.frame_ms.size()), config.warmup, input_name);
+	}
+
+	if (config.profile != "") {
+		if (cpu_profiler_write_trace(config.profile)) {
+			std::cout << "Wrote CPU profile to '" << config.profile << "'." << std::endl;
+		} else {
+			std::cerr << "Failed to write CPU profile to '" << config.profile << "'." << std::endl;
+		}
+	}
+
+	if (config.alloc_stats) {
+		alloc_tracker_enable(false);
+		alloc_tracker().report(std::cout);
+	}
+	if (config.zero_allocs) {
+		bool failed = false;
+		for (char const *name : { "update", "draw" }) {
+			AllocTracker::Tag const *tag = alloc_tracker().find(name);
+			if (tag && tag->total_allocations) {
+				std::cerr << "FAILED: " << name << " allocated " << tag->total_allocations << " times in " << config.frames << " frames (at most " << tag->max_frame_allocations << " in one frame)." << std::endl;
+				failed = true;
+			}
+		}
+		if (failed) {
+			headless.reset();
+			return 1;
+		}
+	}
+
+	#ifdef GL_MOCK
+	gl_mock().report(std::cout);
+	if (config.max_gl_calls != 0 && gl_mock().max_frame_calls > config.max_gl_calls) {
+		std::cerr << "FAILED: a frame made " << gl_mock().max_frame_calls << " GL calls (the limit is " << config.max_gl_calls << ")." << std::endl;
+		headless.reset();
+		return 1;
+	}
+	#endif
+
+	headless.reset();
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	//(e.g., no EGL, a bad --replay file, or a non-numeric --frames)
+	try {
+		return run(argc, argv);
+	} catch (std::exception &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	}
+}
@@ -4,6 +4,38 @@
 //GL.hpp will include a non-namespace-polluting set of opengl prototypes:
 #include "GL.hpp"
 
+//gl_state.hpp tracks GL state to skip redundant calls:
+#include "gl_state.hpp"
+
+//gl_errors.hpp reports gl errors (through KHR_debug, if available):
+#include "gl_errors.hpp"
+
+//frame_limiter.hpp keeps the driver from queuing up frames (and input latency):
+#include "frame_limiter.hpp"
+
+//bench.hpp has scripted/recorded input and frame time reports for --bench runs:
+#include "bench.hpp"
+
+//frame_capture.hpp records the window (to PNGs or Y4M video) without stalling:
+#include "frame_capture.hpp"
+
+//dynamic_resolution.hpp renders at a reduced resolution when frames take too long:
+#include "dynamic_resolution.hpp"
+
+//cpu_profiler.hpp records scoped CPU timings for chrome://tracing (with --profile):
+#include "cpu_profiler.hpp"
+
+//perf_hud.hpp draws the F1 performance overlay:
+#include "perf_hud.hpp"
+
+//alloc_tracker.hpp counts heap allocations per frame and per subsystem (with --alloc-stats):
+#include "alloc_tracker.hpp"
+
+//gl_instrument.hpp counts and times GL calls (in 'jam -sGL_INSTRUMENT=1' builds):
+#ifdef GL_INSTRUMENT
+#include "gl_instrument.hpp"
+#endif
+
 //Includes for libSDL:
 #include <SDL.h>
 
@@ -14,20 +46,142 @@
 
 //...and for c++ standard library functions:
 #include <chrono>
+#include <string>
 #include <iostream>
 #include <stdexcept>
 #include <fstream>
 #include <memory>
 #include <algorithm>
+#include <future>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include <stdexcept>
 
-int main(int argc, char **argv) {
+//(the game itself; main reports anything it throws)
+static int run(int argc, char **argv) {
 	struct {
 		std::string title = "Tilt Escape";
 		glm::uvec2 size = glm::uvec2(800, 600);
+		//run Game::update on its own thread at this rate (or, with --lockstep, once per frame on the main thread):
+		bool lockstep = false;
+		float simulation_rate = 120.0f; //updates per second
+		//frames the GPU may be behind the CPU (fewer = less input latency, more = more throughput; 0 = up to the driver):
+		uint32_t frames_in_flight = 2;
+		//--bench: play bench_level for bench_frames frames (after some warm-up) with vsync off,
+		// a fixed time step, and scripted (or replayed) input, then report frame times:
+		std::string bench_level = "";
+		uint32_t bench_frames = 1000;
+		uint32_t bench_warmup = 30; //frames not counted (shader compiles, cold caches)
+		std::string replay_file = ""; //input for --bench, instead of the script
+		//save each update's controls (and the level) here on exit, for --bench --replay;
+		// while recording, updates take fixed steps, as replays do:
+		std::string record_file = "";
+		std::string json_file = ""; //write the --bench report as JSON here (otherwise to stdout)
+		//record every frame: to <capture>000000.png, ... or (if it ends in .y4m) one Y4M video:
+		std::string capture = "";
+		//if > 0, scale the render resolution (between min and max scale) to keep GPU frame time near this:
+		float dynamic_resolution_ms = 0.0f;
+		float min_scale = 0.5f;
+		float max_scale = 1.0f;
+		//record GL calls (in builds made with 'jam -sGL_TRACE=1') for dist/gl-replay:
+		std::string trace = "";
+		uint32_t trace_frames = 300;
+		//record CPU scopes (see cpu_profiler.hpp) and write them here on exit and on F3:
+		std::string profile = "";
+		//count heap allocations (see alloc_tracker.hpp) and report them on exit:
+		bool alloc_stats = false;
 	} config;
 
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--lockstep") {
+			config.lockstep = true;
+		} else if (arg == "--frames-in-flight" && argi + 1 < argc) {
+			config.frames_in_flight = std::stoul(argv[++argi]);
+		} else if (arg == "--bench" && argi + 1 < argc) {
+			config.bench_level = argv[++argi];
+		} else if (arg == "--frames" && argi + 1 < argc) {
+			config.bench_frames = std::stoul(argv[++argi]);
+		} else if (arg == "--replay" && argi + 1 < argc) {
+			config.replay_file = argv[++argi];
+		} else if (arg == "--record" && argi + 1 < argc) {
+			config.record_file = argv[++argi];
+		} else if (arg == "--json" && argi + 1 < argc) {
+			config.json_file = argv[++argi];
+		} else if (arg == "--capture" && argi + 1 < argc) {
+			config.capture = argv[++argi];
+		} else if (arg == "--dynamic-resolution" && argi + 1 < argc) {
+			config.dynamic_resolution_ms = std::stof(argv[++argi]);
+		} else if (arg == "--min-scale" && argi + 1 < argc) {
+			config.min_scale = std::stof(argv[++argi]);
+		} else if (arg == "--max-scale" && argi + 1 < argc) {
+			config.max_scale = std::stof(argv[++argi]);
+		} else if (arg == "--trace" && argi + 1 < argc) {
+			config.trace = argv[++argi];
+		} else if (arg == "--trace-frames" && argi + 1 < argc) {
+			config.trace_frames = std::stoul(argv[++argi]);
+		} else if (arg == "--profile" && argi + 1 < argc) {
+			config.profile = argv[++argi];
+		} else if (arg == "--alloc-stats") {
+			config.alloc_stats = true;
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--lockstep] [--frames-in-flight N] [--record input.bin] [--capture frames/ | --capture video.y4m]\n"
+				<< "\t\t[--dynamic-resolution TARGET_MS [--min-scale 0.5] [--max-scale 1.0]] [--trace calls.gltrace [--trace-frames 300]]\n"
+				<< "\t\t[--profile trace.json] [--alloc-stats]\n"
+				<< "\t" << argv[0] << " --bench level1.map [--frames N] [--replay input.bin] [--json report.json]" << std::endl;
+			return 1;
+		}
+	}
+
+	#ifndef GL_TRACE
+	if (config.trace != "") {
+		std::cerr << "--trace needs a build with GL tracing ('jam -sGL_TRACE=1')." << std::endl;
+		return 1;
+	}
+	#endif
+
+	bool bench = (config.bench_level != "");
+	//benchmarks should be repeatable, so the simulation runs in step with the frames:
+	if (bench) config.lockstep = true;
+
+	//input for benchmark runs:
+	InputTrack bench_input;
+	if (bench) {
+		if (config.replay_file != "") {
+			bench_input = InputTrack::load(config.replay_file);
+			if (bench_input.level != "" && bench_input.level != config.bench_level) {
+				std::cerr << "'" << config.replay_file << "' was recorded on level '" << bench_input.level << "', not '" << config.bench_level << "'." << std::endl;
+				return 1;
+			}
+		} else {
+			bench_input = InputTrack::scripted(config.bench_warmup + config.bench_frames);
+		}
+	}
+	//input recorded from this run (if --record; by whichever thread runs update):
+	InputTrack recorded_input;
+	bool recording = (config.record_file != "");
+
 	//------------  initialization ------------
 
+	if (config.profile != "") {
+		cpu_profiler_enable(true);
+		cpu_profiler_thread_name("main");
+	}
+	if (config.alloc_stats) alloc_tracker_enable(true);
+
+	//startup is reported as a breakdown of time-to-first-frame:
+	StartupTimeline timeline;
+
+	//asset loading (file I/O, decompression, level parsing) doesn't need GL,
+	//so it runs on worker threads while SDL and the GL context are set up:
+	std::future< Game::Assets > assets = std::async(std::launch::async, [&timeline]() {
+		cpu_profiler_thread_name("asset worker");
+		return Game::load_assets(&timeline);
+	});
+
+	std::unique_ptr< StartupTimeline::Scope > startup_scope(new StartupTimeline::Scope(timeline, "sdl init", "main"));
+
 	//Initialize SDL library:
 	SDL_Init(SDL_INIT_VIDEO);
 
@@ -41,10 +195,14 @@ int main(int argc, char **argv) {
 	SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
 	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+	#ifndef NDEBUG
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+	#endif
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
 
+	startup_scope.reset(new StartupTimeline::Scope(timeline, "create window + context", "main"));
+
 	//create window:
 	SDL_Window *window = SDL_CreateWindow(
 		config.title.c_str(),
@@ -70,19 +228,58 @@ int main(int argc, char **argv) {
 		return 1;
 	}
 
-	#ifdef _WIN32
-	//On windows, load OpenGL extensions:
+	#if defined(_WIN32) || defined(GL_INSTRUMENT)
+	//On windows (and in instrumented builds), load OpenGL extensions:
 	init_gl_shims();
 	#endif
+	#ifdef GL_INSTRUMENT
+	init_gl_instrument();
+	#endif
+
+	#ifdef GL_TRACE
+	//(recording starts before the game creates anything, so the trace has everything a replay needs)
+	if (config.trace != "") {
+		int w = 0, h = 0;
+		SDL_GL_GetDrawableSize(window, &w, &h);
+		gl_trace_start(config.trace, glm::uvec2(w, h), config.trace_frames);
+	}
+	#endif
 
+	#ifndef NDEBUG
+	//Have the driver report errors and performance warnings as they happen (instead of polling glGetError):
+	if (!install_gl_debug_callback()) {
+		std::cerr << "NOTE: KHR_debug not available; polling for gl errors instead." << std::endl;
+	}
+	#endif
+
+	if (bench) {
+		//benchmarks measure how fast frames *could* go:
+		if (SDL_GL_SetSwapInterval(0) != 0) {
+			std::cerr << "NOTE: couldn't turn off vsync (" << SDL_GetError() << "); swap times will include waiting for it." << std::endl;
+		}
+	}
 	//Set VSYNC + Late Swap (prevents crazy FPS):
-	if (SDL_GL_SetSwapInterval(-1) != 0) {
+	else if (SDL_GL_SetSwapInterval(-1) != 0) {
 		std::cerr << "NOTE: couldn't set vsync + late swap tearing (" << SDL_GetError() << ")." << std::endl;
 		if (SDL_GL_SetSwapInterval(1) != 0) {
 			std::cerr << "NOTE: couldn't set vsync (" << SDL_GetError() << ")." << std::endl;
 		}
 	}
 
+	//fences each swapped frame and waits for old ones, so the driver can't queue more than this:
+	std::unique_ptr< FrameLimiter > limiter(new FrameLimiter(config.frames_in_flight));
+
+	std::unique_ptr< FrameCapture > capture;
+	if (config.capture != "") {
+		bool y4m = (config.capture.size() >= 4 && config.capture.substr(config.capture.size() - 4) == ".y4m");
+		capture.reset(new FrameCapture(config.capture, y4m ? FrameCapture::Y4M : FrameCapture::PNG));
+	}
+
+	std::unique_ptr< DynamicResolution > dynamic_resolution;
+	if (config.dynamic_resolution_ms > 0.0f) {
+		dynamic_resolution.reset(new DynamicResolution(config.dynamic_resolution_ms, config.min_scale, config.max_scale));
+	}
+
 	//Hide mouse cursor (note: showing can be useful for debugging):
 	//SDL_ShowCursor(SDL_DISABLE);
 
@@ -95,9 +292,95 @@ int main(int argc, char **argv) {
 
 
 
-	//------------ create game object (loads assets) --------------
+	//------------ create game object (uploads assets) --------------
+
+	startup_scope.reset(new StartupTimeline::Scope(timeline, "wait for assets", "main"));
+	Game::Assets loaded_assets = assets.get();
+
+	startup_scope.reset(new StartupTimeline::Scope(timeline, "create game (GL)", "main"));
+	std::shared_ptr< Game > game = std::make_shared< Game >(std::move(loaded_assets));
+
+	if (bench) {
+		//(guards pick directions with std::rand)
+		std::srand(1);
+		if (!game->select_level(config.bench_level)) {
+			std::cerr << "Unknown level '" << config.bench_level << "'; levels are:";
+			for (auto const &name : game->level_names) std::cerr << " " << name;
+			std::cerr << std::endl;
+			return 1;
+		}
+	}
+	if (recording) {
+		//start the level the way a replay will:
+		recorded_input.level = game->level_names[game->level_index];
+		if (!bench) {
+			std::srand(1);
+			game->select_level(recorded_input.level);
+		}
+	}
+
+	startup_scope.reset(new StartupTimeline::Scope(timeline, "first frame", "main"));
+
+	//------------ simulation thread ------------
+
+	//Game::update runs here, publishing snapshots (see Game::Snapshot) that the
+	//main thread draws; so a slow swap doesn't hold up the simulation, and a
+	//slow update doesn't hold up drawing:
+	std::atomic< bool > simulating(!config.lockstep);
+	std::atomic< float > simulation_update_ms(0.0f); //(how long the latest update took, for the HUD)
+	std::thread simulation;
+	//the simulation thread must stop before the game is deallocated -- on every way out,
+	// including exceptions (destroying a thread that is still running calls std::terminate):
+	struct SimulationStopper {
+		std::thread &thread;
+		std::atomic< bool > &simulating;
+		void stop() {
+			if (thread.joinable()) {
+				simulating = false;
+				thread.join();
+			}
+		}
+		~SimulationStopper() { stop(); }
+	} simulation_stopper{ simulation, simulating };
+	if (simulating) {
+		Game *sim_game = game.get();
+		float simulation_rate = config.simulation_rate;
+		InputTrack *record = (recording ? &recorded_input : nullptr); //(read by main only after the thread stops)
+		simulation = std::thread([sim_game, simulation_rate, record, &simulating, &simulation_update_ms]() {
+			cpu_profiler_thread_name("simulation");
+			typedef std::chrono::high_resolution_clock Clock;
+			//(recording ticks at the replay's fixed step, so the recording plays back at the right speed)
+			float tick_seconds = (record ? InputTrackStep : 1.0f / simulation_rate);
+			Clock::duration tick = std::chrono::duration_cast< Clock::duration >(std::chrono::duration< float >(tick_seconds));
+			Clock::time_point previous_time = Clock::now();
+			Clock::time_point next_tick = previous_time;
+			while (simulating) {
+				Clock::time_point current_time = Clock::now();
+				float elapsed = std::chrono::duration< float >(current_time - previous_time).count();
+				previous_time = current_time;
+
+				//if updates are taking a very long time to process,
+				//lag to avoid spiral of death:
+				elapsed = std::min(0.1f, elapsed);
+
+				if (record) {
+					elapsed = InputTrackStep;
+					record->frames.emplace_back(sim_game->get_controls());
+				}
+
+				sim_game->update(elapsed);
+				simulation_update_ms = std::chrono::duration< float, std::milli >(Clock::now() - current_time).count();
 
-	std::shared_ptr< Game > game = std::make_shared< Game >();
+				//wait for the next tick (or, if behind, start again from now):
+				next_tick += tick;
+				if (next_tick < Clock::now()) next_tick = Clock::now();
+				std::this_thread::sleep_until(next_tick);
+			}
+		});
+	}
+	auto stop_simulation = [&]() {
+		simulation_stopper.stop();
+	};
 
 	//------------ main loop ------------
 
@@ -117,30 +400,67 @@ int main(int argc, char **argv) {
 	};
 	on_resize();
 
+	//the performance overlay (made the first time F1 is pressed):
+	std::unique_ptr< PerfHUD > hud;
+	bool show_hud = false;
+
+	typedef std::chrono::high_resolution_clock Clock;
+	uint32_t frame_index = 0;
+	BenchTimings bench_timings;
+	if (bench) bench_timings.reserve(config.bench_frames);
+	auto ms_between = [](Clock::time_point a, Clock::time_point b) {
+		return std::chrono::duration< float, std::milli >(b - a).count();
+	};
+
 	//This will loop until the game object is set to null:
 	while (game) {
 		//every pass through the game loop creates one frame of output
 		//  by performing three steps:
 
+		Clock::time_point frame_begin = Clock::now();
+		PROFILE_SCOPE("frame");
+
 		{ //(1) process any events that are pending
+			PROFILE_SCOPE("poll events");
+			//(this is the input sampling point: after the limiter's wait, as close to update as possible)
 			static SDL_Event evt;
 			while (SDL_PollEvent(&evt) == 1) {
 				//handle resizing:
 				if (evt.type == SDL_WINDOWEVENT && evt.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
 					on_resize();
 				}
-				//handle input:
+				//F1 shows or hides the performance overlay:
+				if (evt.type == SDL_KEYDOWN && evt.key.keysym.scancode == SDL_SCANCODE_F1) {
+					show_hud = !show_hud;
+					if (show_hud && !hud) hud.reset(new PerfHUD());
+					continue;
+				}
+				//F3 writes the CPU scopes recorded so far (with --profile):
+				if (evt.type == SDL_KEYDOWN && evt.key.keysym.scancode == SDL_SCANCODE_F3 && config.profile != "") {
+					if (cpu_profiler_write_trace(config.profile)) {
+						std::cout << "Wrote CPU profile to '" << config.profile << "'." << std::endl;
+					}
+					continue;
+				}
+				//handle input (benchmarks take theirs from bench_input):
+				if (bench && evt.type != SDL_QUIT) continue;
 				if (game && game->handle_event(evt, window_size)) {
 					// mode handled it; great
 				} else if (evt.type == SDL_QUIT) {
+					stop_simulation();
 					game.reset(); //done: deallocate game
 					break;
 				}
 			}
 			if (!game) break;
+
+			if (bench) game->set_controls(bench_input.at(frame_index));
 		}
 
-		{ //(2) call the game's "update" function to deal with elapsed time:
+		Clock::time_point update_begin = Clock::now();
+
+		if (config.lockstep) { //(2) call the game's "update" function to deal with elapsed time:
+			//(otherwise, update is running on the simulation thread)
 			auto current_time = std::chrono::high_resolution_clock::now();
 			static auto previous_time = current_time;
 			float elapsed = std::chrono::duration< float >(current_time - previous_time).count();
@@ -150,28 +470,165 @@ int main(int argc, char **argv) {
 			//lag to avoid spiral of death:
 			elapsed = std::min(0.1f, elapsed);
 
+			//(benchmarks and recordings step by a fixed amount, so every run simulates the same thing)
+			if (bench || recording) elapsed = InputTrackStep;
+
+			if (recording) recorded_input.frames.emplace_back(game->get_controls());
 			game->update(elapsed);
 			if (!game) break;
 		}
 
+		Clock::time_point draw_begin = Clock::now();
+
 		{ //(3) call the game's "draw" function to produce output:
+			//(with dynamic resolution, the scene is drawn offscreen at a reduced size, then upscaled)
+			glm::uvec2 render_size = drawable_size;
+			if (dynamic_resolution) render_size = dynamic_resolution->begin_frame(drawable_size);
+
 			//clear the depth+color buffers and set some default state:
-			glClearColor(0.5, 0.5, 0.5, 0.0);
+			// (through the state cache, so only the first frame actually sets state)
+			gl_state().clear_color(0.5f, 0.5f, 0.5f, 0.0f);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			glEnable(GL_DEPTH_TEST);
-			glEnable(GL_BLEND);
-			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			gl_state().set_enabled(GL_DEPTH_TEST, true);
+			gl_state().set_enabled(GL_BLEND, true);
+			gl_state().blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+			//draws the newest snapshot published by update:
+			game->draw(render_size);
 
-			game->draw(drawable_size);
+			if (dynamic_resolution) dynamic_resolution->end_frame();
+
+			//the overlay goes over the finished (and upscaled) frame:
+			if (show_hud) hud->draw(drawable_size);
 		}
 
+		//(queues a copy of the frame; encoding happens a few frames later, on another thread)
+		if (capture) capture->capture(drawable_size);
+
+		Clock::time_point swap_begin = Clock::now();
+
 		//Finally, wait until the recently-drawn frame is shown before doing it all again:
-		SDL_GL_SwapWindow(window);
+		{
+			PROFILE_SCOPE("swap");
+			SDL_GL_SwapWindow(window);
+		}
+
+		//...and don't let the driver get too far ahead before reading input again:
+		//(latency is measured from input that the drawn snapshot was the first to show -- see Game::drawn_input_time)
+		limiter->frame_submitted(game->drawn_input_time);
+
+		#ifdef GL_TRACE
+		gl_trace_frame();
+		#endif
+
+		Clock::time_point frame_end = Clock::now();
+
+		//GPU time (which is what resolution affects) arrives a few frames late, from the game's profiler:
+		if (dynamic_resolution) dynamic_resolution->update(game->gpu_profiler.latest_frame_ms);
+
+		gl_state().end_frame();
+		#ifdef GL_INSTRUMENT
+		gl_instrument().end_frame();
+		#endif
+		if (config.alloc_stats) {
+			alloc_tracker().end_frame();
+			if (bench && frame_index + 1 == config.bench_warmup) alloc_tracker().clear(); //(warm-up frames aren't counted)
+		}
+
+		if (hud) {
+			PerfHUD::Frame stats;
+			stats.frame_ms = ms_between(frame_begin, frame_end);
+			stats.update_ms = (config.lockstep ? ms_between(update_begin, draw_begin) : simulation_update_ms.load());
+			stats.draw_ms = ms_between(draw_begin, swap_begin);
+			stats.swap_ms = ms_between(swap_begin, frame_end);
+			stats.gpu_ms = game->gpu_profiler.latest_frame_ms;
+			stats.draws = game->draw_stats.draws;
+			stats.triangles = game->draw_stats.triangles;
+			stats.guards = game->draw_stats.guards;
+			stats.walls = game->draw_stats.walls;
+			#ifdef GL_INSTRUMENT
+			stats.gl_calls = uint32_t(gl_instrument().last.calls);
+			#endif
+			hud->add_frame(stats);
+		}
+
+		if (startup_scope) {
+			startup_scope.reset();
+			timeline.report(std::cout);
+		}
+
+		if (bench) {
+			if (frame_index >= config.bench_warmup) {
+				bench_timings.add(
+					ms_between(update_begin, draw_begin),
+					ms_between(draw_begin, swap_begin),
+					ms_between(swap_begin, frame_end),
+					ms_between(frame_begin, frame_end)
+				);
+			}
+			if (frame_index + 1 >= config.bench_warmup + config.bench_frames) {
+				game.reset(); //done
+			}
+		}
+		++frame_index;
 	}
 
 
 	//------------  teardown ------------
 
+	#ifdef GL_TRACE
+	gl_trace_stop();
+	#endif
+
+	stop_simulation();
+	game.reset();
+	hud.reset();
+
+	if (bench && !bench_timings.frame_ms.empty()) {
+		bench_timings.report(std::cout);
+		std::string input = (config.replay_file != "" ? config.replay_file : "scripted");
+		if (config.json_file != "") {
+			std::ofstream json(config.json_file);
+			bench_timings.report_json(json, config.bench_level, uint32_t(bench_timings.frame_ms.size()), config.bench_warmup, input);
+		} else {
+			bench_timings.report_json(std::cout, config.bench_level, uint32_t(bench_timings.frame_ms.size()), config.bench_warmup, input);
+		}
+	}
+
+	if (config.profile != "") {
+		if (cpu_profiler_write_trace(config.profile)) {
+			std::cout << "Wrote CPU profile to '" << config.profile << "'." << std::endl;
+		} else {
+			std::cerr << "Failed to write CPU profile to '" << config.profile << "'." << std::endl;
+		}
+	}
+
+	if (config.record_file != "") {
+		recorded_input.save(config.record_file);
+		std::cout << "Recorded " << recorded_input.frames.size() << " updates of input on '" << recorded_input.level << "' to '" << config.record_file << "'." << std::endl;
+	}
+
+	gl_state().report(std::cout);
+	#ifdef GL_INSTRUMENT
+	gl_instrument().report(std::cout);
+	#endif
+	if (config.alloc_stats) {
+		alloc_tracker_enable(false);
+		alloc_tracker().report(std::cout);
+	}
+	limiter->report(std::cout);
+	limiter.reset();
+
+	if (dynamic_resolution) {
+		dynamic_resolution->report(std::cout);
+		dynamic_resolution.reset();
+	}
+
+	if (capture) {
+		capture->report(std::cout);
+		capture.reset(); //(finishes writing queued frames)
+	}
+
 	SDL_GL_DeleteContext(context);
 	context = 0;
 
@@ -180,3 +637,13 @@ int main(int argc, char **argv) {
 
 	return 0;
 }
+
+int main(int argc, char **argv) {
+	//(catching here also makes sure the stack unwinds, so the simulation thread is stopped and joined)
+	try {
+		return run(argc, argv);
+	} catch (std::exception &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	}
+}
@@ -5,6 +5,7 @@
 import re
 
 protos = []
+core_1_0 = [] #(DO entries for the prototyped 1.0 functions; see GL_SHIMS_1_0 below)
 extensions = []
 
 with open('glcorearb.h', 'r') as f:
@@ -20,7 +21,7 @@ with open('glcorearb.h', 'r') as f:
 				protos.append("\n// " + in_version + " prototypes:\n")
 				do_proto = True
 				do_extension = False
-			elif (major,minor) < (3,3):
+			elif (major,minor) <= (3,3):
 				extensions.append("\n// " + in_version + " extensions:\n")
 				do_proto = False
 				do_extension = True
@@ -32,10 +33,13 @@ with open('glcorearb.h', 'r') as f:
 				m = re.match(r"^GLAPI ", line)
 				if m != None:
 					protos.append(line)
+				m = re.match(r"GLAPI .*[ *]APIENTRY gl([^ ]+) \(", line)
+				if m != None:
+					core_1_0.append("DO(" + m.group(1).upper() + ", " + m.group(1) + ")\n")
 				pass
 			if do_extension:
 			#	m = re.match(r".* PFNGL([^)]+)PROC\)", line)
-				m = re.match(r"GLAPI .* APIENTRY gl([^ ]+) \(", line)
+				m = re.match(r"GLAPI .*[ *]APIENTRY gl([^ ]+) \(", line)
 				if m != None:
 					lc = m.group(1)
 					uc = lc.upper()
@@ -53,6 +57,10 @@ print("""#ifndef GL_SHIMS_HPP
 #include "glcorearb.h"
 
 void init_gl_shims(); //will throw on failure.
+
+//GL 1.0 functions are usually linked directly (opengl32.lib exports them);
+// builds that define GL_SHIMS_1_0 load them through pointers like the rest:
+#ifndef GL_SHIMS_1_0
 //Prototypes for 1.0,1.1 functionality, pretty sure that already exists:
 
 extern "C" {
@@ -63,6 +71,8 @@ print("".join(protos))
 print("""
 }
 
+#endif //GL_SHIMS_1_0
+
 #endif //PROTOTYPES
 
 //--------------------------------------------------------
@@ -74,6 +84,11 @@ print("""
 
 """)
 
+print("#ifdef GL_SHIMS_1_0")
+print("\n// GL_VERSION_1_0 (loaded):\n")
+print("".join(core_1_0))
+print("#endif //GL_SHIMS_1_0")
+
 print("".join(extensions))
 
 print("#endif //GL_SHIMS_HPP")
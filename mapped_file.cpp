@@ -0,0 +1,88 @@
+#include "mapped_file.hpp"
+
+#include <stdexcept>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(std::string const &filename) {
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Failed to open '" + filename + "' for mapping.");
+	}
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size)) {
+		CloseHandle(file);
+		throw std::runtime_error("Failed to get size of '" + filename + "'.");
+	}
+	size_ = size_t(file_size.QuadPart);
+	file_handle = file;
+	if (size_ == 0) return; //can't map empty files, but they are still valid files
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL) {
+		CloseHandle(file);
+		throw std::runtime_error("Failed to create mapping of '" + filename + "'.");
+	}
+	void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == NULL) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		throw std::runtime_error("Failed to map '" + filename + "'.");
+	}
+	mapping_handle = mapping;
+	data_ = reinterpret_cast< char const * >(view);
+}
+
+MappedFile::~MappedFile() {
+	if (data_) UnmapViewOfFile(data_);
+	if (mapping_handle) CloseHandle(reinterpret_cast< HANDLE >(mapping_handle));
+	if (file_handle) CloseHandle(reinterpret_cast< HANDLE >(file_handle));
+}
+
+void MappedFile::advise_sequential() const {
+}
+
+#else
+
+MappedFile::MappedFile(std::string const &filename) {
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("Failed to open '" + filename + "' for mapping.");
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		close(fd);
+		throw std::runtime_error("Failed to get size of '" + filename + "'.");
+	}
+	size_ = size_t(info.st_size);
+	if (size_ == 0) { //can't map empty files, but they are still valid files
+		close(fd);
+		return;
+	}
+	void *mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+	//the mapping keeps its own reference to the file:
+	close(fd);
+	if (mapped == MAP_FAILED) {
+		throw std::runtime_error("Failed to map '" + filename + "'.");
+	}
+	data_ = reinterpret_cast< char const * >(mapped);
+}
+
+MappedFile::~MappedFile() {
+	if (data_) munmap(const_cast< char * >(data_), size_);
+}
+
+void MappedFile::advise_sequential() const {
+	if (data_) madvise(const_cast< char * >(data_), size_, MADV_SEQUENTIAL);
+}
+
+#endif
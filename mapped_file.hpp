@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+//MappedFile maps a whole file read-only into memory (mmap / MapViewOfFile),
+// so its contents can be used in place without being copied through a stream.
+//   MappedFile blob(data_path("meshes.blob"));
+//   char const *at = blob.data(); ...
+//Pages are faulted in from the OS file cache as they are touched, and can be
+// evicted again under memory pressure, so even very large files don't count
+// against peak (private) memory use.
+struct MappedFile {
+	//throws std::runtime_error if the file can't be opened or mapped:
+	explicit MappedFile(std::string const &filename);
+	~MappedFile();
+
+	MappedFile(MappedFile const &) = delete;
+	MappedFile &operator=(MappedFile const &) = delete;
+
+	char const *data() const { return data_; }
+	size_t size() const { return size_; }
+	char const *begin() const { return data_; }
+	char const *end() const { return data_ + size_; }
+
+	//hint that the mapping will be read front-to-back (no-op where unsupported):
+	void advise_sequential() const;
+
+private:
+	char const *data_ = nullptr;
+	size_t size_ = 0;
+	#if defined(_WIN32)
+	void *file_handle = nullptr;
+	void *mapping_handle = nullptr;
+	#endif
+};
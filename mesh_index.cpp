@@ -0,0 +1,80 @@
+#include "mesh_index.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+MeshIndex::MeshIndex(ChunkView const &names_, ChunkView const &index, size_t vertex_count) : names(names_.data) {
+	if (index.size % sizeof(Entry) != 0) {
+		throw std::runtime_error("Size of index not divisible by entry size.");
+	}
+	count = index.size / sizeof(Entry);
+
+	//entries are used in place when they are aligned:
+	if (reinterpret_cast< uintptr_t >(index.data) % alignof(Entry) == 0) {
+		entries = reinterpret_cast< Entry const * >(index.data);
+	} else {
+		sorted_copy.resize(count);
+		if (count) std::memcpy(&sorted_copy[0], index.data, index.size);
+		entries = sorted_copy.data();
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		Entry const &e = entries[i];
+		if (e.name_begin > e.name_end || e.name_end > names_.size) {
+			throw std::runtime_error("invalid name indices in index.");
+		}
+		if (e.vertex_begin > e.vertex_end || e.vertex_end > vertex_count) {
+			throw std::runtime_error("invalid vertex indices in index.");
+		}
+	}
+
+	auto less = [this](Entry const &a, Entry const &b) {
+		return compare(a, names + b.name_begin, b.name_end - b.name_begin) < 0;
+	};
+
+	//...and sorted if they weren't exported that way:
+	if (!std::is_sorted(entries, entries + count, less)) {
+		if (sorted_copy.empty()) {
+			sorted_copy.assign(entries, entries + count);
+			entries = sorted_copy.data();
+		}
+		std::sort(sorted_copy.begin(), sorted_copy.end(), less);
+	}
+
+	for (size_t i = 1; i < count; ++i) {
+		if (!less(entries[i-1], entries[i])) {
+			throw std::runtime_error("duplicate name in index.");
+		}
+	}
+}
+
+int MeshIndex::compare(Entry const &e, char const *name, size_t length) const {
+	size_t e_length = e.name_end - e.name_begin;
+	int ret = std::memcmp(names + e.name_begin, name, std::min(e_length, length));
+	if (ret != 0) return ret;
+	if (e_length < length) return -1;
+	if (e_length > length) return 1;
+	return 0;
+}
+
+MeshHandle MeshIndex::find(char const *name, size_t length) const {
+	size_t begin = 0;
+	size_t end = count;
+	while (begin < end) {
+		size_t mid = begin + (end - begin) / 2;
+		int c = compare(entries[mid], name, length);
+		if (c == 0) return MeshHandle(mid);
+		if (c < 0) begin = mid + 1;
+		else end = mid;
+	}
+	return InvalidMesh;
+}
+
+MeshHandle MeshIndex::lookup(std::string const &name) const {
+	MeshHandle handle = find(name.c_str(), name.size());
+	if (handle == InvalidMesh) {
+		throw std::runtime_error("Mesh named '" + name + "' does not appear in index.");
+	}
+	return handle;
+}
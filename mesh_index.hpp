@@ -0,0 +1,53 @@
+#pragma once
+
+#include "read_chunk.hpp"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+//MeshIndex searches the name table ('str0' + 'idx0' chunks) of a meshes blob in place.
+//
+//meshes/export-meshes.py writes index entries sorted by name (and pads 'str0' so
+// 'idx0' stays aligned), so lookups are a binary search over the mapped file with
+// no allocations; older unsorted or unaligned blobs are sorted into a copy instead.
+//
+//Meshes are identified by MeshHandle -- the position of the mesh's entry in the
+// sorted table -- so per-mesh data can be kept in a flat array indexed by handle:
+//   MeshIndex index(names_chunk, index_chunk, vertex_count);
+//   MeshHandle player = index.lookup("Player");
+//   MeshIndex::Entry const &e = index[player];
+//The index refers to the chunk memory, so it must not outlive the blob.
+
+typedef uint32_t MeshHandle;
+const MeshHandle InvalidMesh = MeshHandle(-1);
+
+struct MeshIndex {
+	struct Entry {
+		uint32_t name_begin;
+		uint32_t name_end;
+		uint32_t vertex_begin;
+		uint32_t vertex_end;
+	};
+	static_assert(sizeof(Entry) == 16, "Entry should be packed.");
+
+	//validates all entries (throws std::runtime_error on bad ranges or duplicate names):
+	MeshIndex(ChunkView const &names, ChunkView const &index, size_t vertex_count);
+
+	size_t size() const { return count; }
+	Entry const &operator[](MeshHandle handle) const { return entries[handle]; }
+
+	//returns InvalidMesh if no mesh has this name:
+	MeshHandle find(char const *name, size_t length) const;
+	//throws if no mesh has this name:
+	MeshHandle lookup(std::string const &name) const;
+
+private:
+	int compare(Entry const &e, char const *name, size_t length) const;
+
+	char const *names = nullptr;
+	Entry const *entries = nullptr;
+	size_t count = 0;
+	//only used when the table in the blob can't be searched in place:
+	std::vector< Entry > sorted_copy;
+};
@@ -28,12 +28,29 @@ bpy.ops.wm.open_mainfile(filepath=infile)
 
 do_texcoord = False
 
+#write 'dat1' (half-float position, 10:10:10 normal, 16 bytes/vertex) instead of 'dat0' (float position + normal, 28 bytes/vertex):
+do_packed = False
+
+if do_packed:
+	import numpy
+
+#snorm10 packing as per GL_INT_2_10_10_10_REV:
+def pack_snorm10x3(v):
+	bits = 0
+	for i in range(0,3):
+		c = int(round(max(-1.0, min(1.0, v[i])) * 511.0))
+		bits |= (c & 0x3ff) << (10 * i)
+	return struct.pack('I', bits)
+
 #names of objects whose meshes to write (not actually the names of the meshes):
 to_write = []
 for obj in bpy.data.objects:
 	if obj.type == 'MESH':
 		to_write.append(obj.name)
 
+#the runtime binary-searches the index in place, so write it sorted by (utf8) name:
+to_write.sort(key=lambda name: bytes(name, "utf8"))
+
 #data contains vertex and normal data from the meshes:
 data = b''
 
@@ -93,10 +110,15 @@ for name in to_write:
 			assert(mesh.loops[poly.loop_indices[i]].vertex_index == poly.vertices[i])
 			loop = mesh.loops[poly.loop_indices[i]]
 			vertex = mesh.vertices[loop.vertex_index]
-			for x in mesh.vertices[loop.vertex_index].co:
-				data += struct.pack('f', x)
-			for x in loop.normal:
-				data += struct.pack('f', x)
+			if do_packed:
+				co = mesh.vertices[loop.vertex_index].co
+				data += numpy.array([co.x, co.y, co.z, 1.0], dtype=numpy.float16).tobytes()
+				data += pack_snorm10x3(loop.normal)
+			else:
+				for x in mesh.vertices[loop.vertex_index].co:
+					data += struct.pack('f', x)
+				for x in loop.normal:
+					data += struct.pack('f', x)
 			#TODO: set 'col' based on object's active vertex colors array.
 			# you should be able to use code much like the texcoord code below.
 			vert_id = poly.vertices[i]
@@ -112,12 +134,19 @@ for name in to_write:
 	vertex_count += len(mesh.polygons) * 3
 
 #check that we wrote as much data as anticipated:
-assert(vertex_count * (4*3+4*3+4*1) == len(data))
+if do_packed:
+	assert(vertex_count * (2*4+4*1+4*1) == len(data))
+else:
+	assert(vertex_count * (4*3+4*3+4*1) == len(data))
+
+#pad strings so that the index chunk after them stays 4-byte aligned (the runtime uses it in place):
+while len(strings) % 4 != 0:
+	strings += b'\0'
 
 #write the data chunk and index chunk to an output blob:
 blob = open(outfile, 'wb')
 #first chunk: the data
-blob.write(struct.pack('4s',b'dat0')) #type
+blob.write(struct.pack('4s',b'dat1' if do_packed else b'dat0')) #type
 blob.write(struct.pack('I', len(data))) #length
 blob.write(data)
 #second chunk: the strings
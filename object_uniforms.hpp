@@ -0,0 +1,45 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+//ObjectUniforms holds the data that changes per draw (transforms).
+//Each draw's copy is written into a StreamBuffer (see stream_buffer.hpp) and
+// bound with glBindBufferRange, instead of going through glUniform* calls.
+
+//matches the std140 layout of the GLSL block below:
+struct ObjectUniforms {
+	glm::vec4 object_to_light[4]; //mat4x3 columns (w unused)
+	glm::vec4 normal_to_light[3]; //mat3 columns (w unused)
+};
+static_assert(sizeof(ObjectUniforms) == 4 * 16 + 3 * 16, "ObjectUniforms should match std140 layout.");
+
+#define OBJECT_UNIFORMS_GLSL \
+	"layout(std140) uniform Object {\n" \
+	"	mat4x3 object_to_light;\n" \
+	"	mat3 normal_to_light;\n" \
+	"};\n"
+
+//uniform buffer binding point draws bind their ObjectUniforms range to:
+const GLuint ObjectUniformsBinding = 1;
+
+//point a program's 'Object' block (if it uses one) at ObjectUniformsBinding:
+inline void bind_object_uniforms(GLuint program) {
+	GLuint index = glGetUniformBlockIndex(program, "Object");
+	if (index != GL_INVALID_INDEX) {
+		glUniformBlockBinding(program, index, ObjectUniformsBinding);
+	}
+}
+
+//fill 'out' (which may be write-only mapped memory) for an object placed by 'object_to_world':
+inline void write_object_uniforms(ObjectUniforms *out, glm::mat4 const &object_to_world) {
+	for (int c = 0; c < 4; ++c) {
+		out->object_to_light[c] = object_to_world[c];
+	}
+	//NOTE: if there isn't any non-uniform scaling in the object_to_world matrix, then the inverse transpose is the matrix itself, and computing it wastes some CPU time:
+	glm::mat3 normal_to_world = glm::inverse(glm::transpose(glm::mat3(object_to_world)));
+	for (int c = 0; c < 3; ++c) {
+		out->normal_to_light[c] = glm::vec4(normal_to_world[c], 0.0f);
+	}
+}
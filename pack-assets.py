@@ -0,0 +1,71 @@
+#!/usr/bin/env python3
+
+#pack asset files into a compressed asset pack (read by asset_pack.cpp):
+# ./pack-assets.py dist/assets.pak dist/meshes.blob dist/*.map
+#files are stored under their base names; each file is split into blocks that
+# are compressed independently (so the runtime can inflate them in parallel).
+
+import os
+import struct
+import sys
+import zlib
+
+BLOCK_SIZE = 1024 * 1024
+
+STORED = 0
+DEFLATED = 1
+
+if len(sys.argv) < 3:
+	print("Usage:\n\t" + sys.argv[0] + " <out.pak> <file> [<file> ...]")
+	exit(1)
+
+outfile = sys.argv[1]
+infiles = sorted(sys.argv[2:], key=lambda path: bytes(os.path.basename(path), "utf8"))
+
+names = b''
+entries = b''
+blocks = b''
+data = b''
+
+seen = set()
+for path in infiles:
+	name = os.path.basename(path)
+	if name in seen:
+		print("ERROR: two files named '" + name + "'.")
+		exit(1)
+	seen.add(name)
+
+	with open(path, 'rb') as f:
+		contents = f.read()
+
+	name_begin = len(names)
+	names += bytes(name, "utf8")
+	name_end = len(names)
+
+	block_begin = len(blocks) // 16
+	for begin in range(0, len(contents), BLOCK_SIZE):
+		raw = contents[begin:begin+BLOCK_SIZE]
+		packed = zlib.compress(raw, 9)
+		#keep blocks that don't compress uncompressed:
+		if len(packed) < len(raw):
+			method = DEFLATED
+		else:
+			method = STORED
+			packed = raw
+		blocks += struct.pack('IIII', len(data), len(data) + len(packed), len(raw), method)
+		data += packed
+	block_end = len(blocks) // 16
+
+	entries += struct.pack('IIIII', name_begin, name_end, block_begin, block_end, len(contents))
+	print("Packed '" + name + "': " + str(len(contents)) + " bytes in " + str(block_end - block_begin) + " blocks.")
+
+#pad names so that the directory after them stays 4-byte aligned (the runtime uses it in place):
+while len(names) % 4 != 0:
+	names += b'\0'
+
+with open(outfile, 'wb') as out:
+	for magic, chunk in [(b'pkn0', names), (b'pke0', entries), (b'pkb0', blocks), (b'pkd0', data)]:
+		out.write(struct.pack('4s', magic))
+		out.write(struct.pack('I', len(chunk)))
+		out.write(chunk)
+	print("Wrote " + str(out.tell()) + " bytes [" + str(len(data)) + " bytes of compressed data] to '" + outfile + "'.")
@@ -0,0 +1,354 @@
+#include "perf_hud.hpp"
+
+#include "gl_state.hpp"
+#include "vertex_layout.hpp"
+#include "cpu_profiler.hpp"
+#include "alloc_tracker.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#else
+#include <unistd.h>
+#endif
+
+template< >
+struct AttribFormat< PerfHUD::GlyphTexel > {
+	static const GLint size = 4;
+	static const GLenum type = GL_UNSIGNED_BYTE;
+	static const GLboolean normalized = GL_FALSE; //(texel coordinates and glyph index, as-is)
+};
+
+typedef VertexLayout< PerfHUD::Vertex,
+	VERTEX_ATTRIB(PerfHUD::Vertex, Position),
+	VERTEX_ATTRIB(PerfHUD::Vertex, Glyph),
+	VERTEX_ATTRIB(PerfHUD::Vertex, Color)
+> PerfHUDLayout;
+
+//5x7 font for ' ' .. '~': one byte per column, left to right; bit 0 is the top row:
+static const uint8_t Font5x7[95][5] = {
+	{0x00,0x00,0x00,0x00,0x00}, {0x00,0x00,0x5F,0x00,0x00}, {0x00,0x07,0x00,0x07,0x00}, {0x14,0x7F,0x14,0x7F,0x14}, // !"#
+	{0x24,0x2A,0x7F,0x2A,0x12}, {0x23,0x13,0x08,0x64,0x62}, {0x36,0x49,0x55,0x22,0x50}, {0x00,0x05,0x03,0x00,0x00}, //$%&'
+	{0x00,0x1C,0x22,0x41,0x00}, {0x00,0x41,0x22,0x1C,0x00}, {0x08,0x2A,0x1C,0x2A,0x08}, {0x08,0x08,0x3E,0x08,0x08}, //()*+
+	{0x00,0x50,0x30,0x00,0x00}, {0x08,0x08,0x08,0x08,0x08}, {0x00,0x60,0x60,0x00,0x00}, {0x20,0x10,0x08,0x04,0x02}, //,-./
+	{0x3E,0x51,0x49,0x45,0x3E}, {0x00,0x42,0x7F,0x40,0x00}, {0x42,0x61,0x51,0x49,0x46}, {0x21,0x41,0x45,0x4B,0x31}, //0123
+	{0x18,0x14,0x12,0x7F,0x10}, {0x27,0x45,0x45,0x45,0x39}, {0x3C,0x4A,0x49,0x49,0x30}, {0x01,0x71,0x09,0x05,0x03}, //4567
+	{0x36,0x49,0x49,0x49,0x36}, {0x06,0x49,0x49,0x29,0x1E}, {0x00,0x36,0x36,0x00,0x00}, {0x00,0x56,0x36,0x00,0x00}, //89:;
+	{0x08,0x14,0x22,0x41,0x00}, {0x14,0x14,0x14,0x14,0x14}, {0x00,0x41,0x22,0x14,0x08}, {0x02,0x01,0x51,0x09,0x06}, //<=>?
+	{0x32,0x49,0x79,0x41,0x3E}, {0x7E,0x11,0x11,0x11,0x7E}, {0x7F,0x49,0x49,0x49,0x36}, {0x3E,0x41,0x41,0x41,0x22}, //@ABC
+	{0x7F,0x41,0x41,0x22,0x1C}, {0x7F,0x49,0x49,0x49,0x41}, {0x7F,0x09,0x09,0x09,0x01}, {0x3E,0x41,0x49,0x49,0x7A}, //DEFG
+	{0x7F,0x08,0x08,0x08,0x7F}, {0x00,0x41,0x7F,0x41,0x00}, {0x20,0x40,0x41,0x3F,0x01}, {0x7F,0x08,0x14,0x22,0x41}, //HIJK
+	{0x7F,0x40,0x40,0x40,0x40}, {0x7F,0x02,0x0C,0x02,0x7F}, {0x7F,0x04,0x08,0x10,0x7F}, {0x3E,0x41,0x41,0x41,0x3E}, //LMNO
+	{0x7F,0x09,0x09,0x09,0x06}, {0x3E,0x41,0x51,0x21,0x5E}, {0x7F,0x09,0x19,0x29,0x46}, {0x46,0x49,0x49,0x49,0x31}, //PQRS
+	{0x01,0x01,0x7F,0x01,0x01}, {0x3F,0x40,0x40,0x40,0x3F}, {0x1F,0x20,0x40,0x20,0x1F}, {0x3F,0x40,0x38,0x40,0x3F}, //TUVW
+	{0x63,0x14,0x08,0x14,0x63}, {0x07,0x08,0x70,0x08,0x07}, {0x61,0x51,0x49,0x45,0x43}, {0x00,0x7F,0x41,0x41,0x00}, //XYZ[
+	{0x02,0x04,0x08,0x10,0x20}, {0x00,0x41,0x41,0x7F,0x00}, {0x04,0x02,0x01,0x02,0x04}, {0x40,0x40,0x40,0x40,0x40}, //\]^_
+	{0x00,0x01,0x02,0x04,0x00}, {0x20,0x54,0x54,0x54,0x78}, {0x7F,0x48,0x44,0x44,0x38}, {0x38,0x44,0x44,0x44,0x20}, //`abc
+	{0x38,0x44,0x44,0x48,0x7F}, {0x38,0x54,0x54,0x54,0x18}, {0x08,0x7E,0x09,0x01,0x02}, {0x0C,0x52,0x52,0x52,0x3E}, //defg
+	{0x7F,0x08,0x04,0x04,0x78}, {0x00,0x44,0x7D,0x40,0x00}, {0x20,0x40,0x44,0x3D,0x00}, {0x7F,0x10,0x28,0x44,0x00}, //hijk
+	{0x00,0x41,0x7F,0x40,0x00}, {0x7C,0x04,0x18,0x04,0x78}, {0x7C,0x08,0x04,0x04,0x78}, {0x38,0x44,0x44,0x44,0x38}, //lmno
+	{0x7C,0x14,0x14,0x14,0x08}, {0x08,0x14,0x14,0x18,0x7C}, {0x7C,0x08,0x04,0x04,0x08}, {0x48,0x54,0x54,0x54,0x20}, //pqrs
+	{0x04,0x3F,0x44,0x40,0x20}, {0x3C,0x40,0x40,0x20,0x7C}, {0x1C,0x20,0x40,0x20,0x1C}, {0x3C,0x40,0x30,0x40,0x3C}, //tuvw
+	{0x44,0x28,0x10,0x28,0x44}, {0x0C,0x50,0x50,0x50,0x3C}, {0x44,0x64,0x54,0x4C,0x44}, {0x00,0x08,0x36,0x41,0x00}, //xyz{
+	{0x00,0x00,0x7F,0x00,0x00}, {0x00,0x41,0x36,0x08,0x00}, {0x08,0x04,0x08,0x10,0x08}, //|}~
+};
+
+//the font as a GLSL constant array, four columns to a uint:
+static std::string font_glsl() {
+	uint32_t const bytes = sizeof(Font5x7);
+	uint8_t const *font = &Font5x7[0][0];
+	uint32_t words = (bytes + 3) / 4;
+	std::string ret = "const uint font[" + std::to_string(words) + "] = uint[" + std::to_string(words) + "](";
+	for (uint32_t w = 0; w < words; ++w) {
+		uint32_t word = 0;
+		for (uint32_t b = 0; b < 4 && w * 4 + b < bytes; ++b) {
+			word |= uint32_t(font[w * 4 + b]) << (8 * b);
+		}
+		char hex[16];
+		std::snprintf(hex, sizeof(hex), "0x%08Xu", word);
+		ret += (w ? ", " : "");
+		ret += hex;
+	}
+	ret += ");\n";
+	return ret;
+}
+
+PerfHUD::PerfHUD() {
+	handle = shaders.submit("perf_hud",
+		"#version 330\n"
+		"layout(location=0) in vec2 Position;\n"
+		"layout(location=1) in vec4 Glyph;\n"
+		"layout(location=2) in vec4 Color;\n"
+		"out vec2 texel;\n"
+		"flat out int glyph;\n"
+		"out vec4 color;\n"
+		"void main() {\n"
+		"	gl_Position = vec4(Position, 0.0, 1.0);\n"
+		"	texel = Glyph.xy;\n"
+		"	glyph = int(Glyph.z);\n"
+		"	color = Color;\n"
+		"}\n",
+		"#version 330\n"
+		+ font_glsl() +
+		"in vec2 texel;\n"
+		"flat in int glyph;\n"
+		"in vec4 color;\n"
+		"out vec4 fragColor;\n"
+		"void main() {\n"
+		"	if (glyph < " + std::to_string(int(SolidGlyph)) + ") {\n"
+		"		int x = int(texel.x);\n"
+		"		int y = int(texel.y);\n"
+		"		if (x >= 5 || y >= 7) discard;\n"
+		"		int column = glyph * 5 + x;\n"
+		"		if (((font[column / 4] >> uint((column % 4) * 8 + y)) & 1u) == 0u) discard;\n"
+		"	}\n"
+		"	fragColor = color;\n"
+		"}\n"
+	);
+
+	//(room for the text and a full graph; it grows if needed)
+	stream.reset(new StreamBuffer(GL_ARRAY_BUFFER, 128 * 1024, sizeof(Vertex)));
+	glGenVertexArrays(1, &vao);
+	vertices.reserve(128 * 1024 / sizeof(Vertex));
+}
+
+PerfHUD::~PerfHUD() {
+	glDeleteVertexArrays(1, &vao);
+	vao = 0;
+	stream.reset();
+	//(the program is deleted by 'shaders')
+	//deleting bound objects unbinds them:
+	gl_state().invalidate();
+}
+
+void PerfHUD::add_frame(Frame const &frame) {
+	history[history_next] = frame;
+	history_next = (history_next + 1) % HistorySize;
+	history_count = std::min< uint32_t >(history_count + 1, HistorySize);
+
+	interval_sum.frame_ms += frame.frame_ms;
+	interval_sum.update_ms += frame.update_ms;
+	interval_sum.draw_ms += frame.draw_ms;
+	interval_sum.swap_ms += frame.swap_ms;
+	interval_sum.gpu_ms += frame.gpu_ms;
+	interval_max_ms = std::max(interval_max_ms, frame.frame_ms);
+	++interval_frames;
+
+	//(the first frame gets text right away)
+	if (interval_frames >= TextInterval || line_count == 0) {
+		update_lines();
+		interval_sum = Frame();
+		interval_max_ms = 0.0f;
+		interval_frames = 0;
+	}
+}
+
+void PerfHUD::update_lines() {
+	float per = 1.0f / float(interval_frames);
+	Frame const &last = history[(history_next + HistorySize - 1) % HistorySize];
+	float frame_ms = interval_sum.frame_ms * per;
+
+	line_count = 0;
+	print("frame %5.2fms avg %5.2fms max (%.0f fps)", frame_ms, interval_max_ms, (frame_ms > 0.0f ? 1000.0f / frame_ms : 0.0f));
+	print("update %5.2f  draw %5.2f  swap %5.2f  gpu %5.2f", interval_sum.update_ms * per, interval_sum.draw_ms * per, interval_sum.swap_ms * per, interval_sum.gpu_ms * per);
+	if (last.gl_calls) {
+		print("draws %u  triangles %u  gl calls %u", last.draws, last.triangles, last.gl_calls);
+	} else {
+		print("draws %u  triangles %u", last.draws, last.triangles);
+	}
+	print("guards %u  walls %u", last.guards, last.walls);
+	uint64_t resident = process_resident_bytes();
+	if (resident) {
+		print("memory %.1f MB resident", double(resident) / (1024.0 * 1024.0));
+	} else {
+		print("memory ?");
+	}
+	print("hud %.3fms", draw_cpu_ms);
+}
+
+void PerfHUD::print(char const *format, ...) {
+	if (line_count >= MaxLines) return;
+	va_list args;
+	va_start(args, format);
+	std::vsnprintf(lines[line_count++], LineLength, format, args);
+	va_end(args);
+}
+
+void PerfHUD::quad(glm::vec2 min, glm::vec2 max, uint8_t glyph, glm::u8vec4 color) {
+	auto vertex = [&](glm::vec2 const &at, uint8_t x, uint8_t y) {
+		Vertex v;
+		v.Position = glm::vec2(at.x * to_clip.x - 1.0f, at.y * to_clip.y + 1.0f);
+		v.Glyph.x = x;
+		v.Glyph.y = y;
+		v.Glyph.glyph = glyph;
+		v.Glyph.pad = 0;
+		v.Color = color;
+		vertices.emplace_back(v);
+	};
+	vertex(glm::vec2(min.x, min.y), 0, 0);
+	vertex(glm::vec2(min.x, max.y), 0, 8);
+	vertex(glm::vec2(max.x, max.y), 6, 8);
+	vertex(glm::vec2(min.x, min.y), 0, 0);
+	vertex(glm::vec2(max.x, max.y), 6, 8);
+	vertex(glm::vec2(max.x, min.y), 6, 0);
+}
+
+void PerfHUD::rect(glm::vec2 min, glm::vec2 max, glm::u8vec4 color) {
+	quad(min, max, SolidGlyph, color);
+}
+
+void PerfHUD::line(glm::vec2 a, glm::vec2 b, float width, glm::u8vec4 color) {
+	glm::vec2 along = b - a;
+	float length = glm::length(along);
+	if (length == 0.0f) return;
+	glm::vec2 side = glm::vec2(-along.y, along.x) * (0.5f * width / length);
+	auto vertex = [&](glm::vec2 const &at) {
+		Vertex v;
+		v.Position = glm::vec2(at.x * to_clip.x - 1.0f, at.y * to_clip.y + 1.0f);
+		v.Glyph.x = v.Glyph.y = v.Glyph.pad = 0;
+		v.Glyph.glyph = SolidGlyph;
+		v.Color = color;
+		vertices.emplace_back(v);
+	};
+	vertex(a - side);
+	vertex(b - side);
+	vertex(b + side);
+	vertex(a - side);
+	vertex(b + side);
+	vertex(a + side);
+}
+
+void PerfHUD::text(glm::vec2 at, char const *str, glm::u8vec4 color) {
+	for (char const *c = str; *c; ++c) {
+		if (*c != ' ') {
+			uint8_t glyph = (*c > ' ' && *c <= '~' ? uint8_t(*c - ' ') : uint8_t('?' - ' '));
+			quad(at, at + glm::vec2(6.0f, 8.0f) * scale, glyph, color);
+		}
+		at.x += 6.0f * scale;
+	}
+}
+
+void PerfHUD::draw(glm::uvec2 drawable_size) {
+	PROFILE_SCOPE("hud");
+	ALLOC_TAG("hud");
+	typedef std::chrono::high_resolution_clock Clock;
+	Clock::time_point begin = Clock::now();
+
+	if (drawable_size.x == 0 || drawable_size.y == 0) return;
+
+	//whole pixels per font texel, so text stays sharp (and readable on high-DPI displays):
+	scale = float(std::max(1U, drawable_size.y / 600U));
+	to_clip = glm::vec2(2.0f / float(drawable_size.x), -2.0f / float(drawable_size.y));
+	vertices.clear();
+
+	//---- build the batch ----
+	const float GraphMaxMs = 50.0f; //top of the graph
+	float pad = 4.0f * scale;
+	float line_height = 10.0f * scale;
+	float graph_width = float(HistorySize) * scale;
+	float graph_height = 60.0f * scale;
+
+	uint32_t longest = 0;
+	for (uint32_t l = 0; l < line_count; ++l) {
+		longest = std::max(longest, uint32_t(std::strlen(lines[l])));
+	}
+	float width = std::max(graph_width, float(longest) * 6.0f * scale);
+	glm::vec2 corner = glm::vec2(pad, pad);
+	glm::vec2 text_at = corner + glm::vec2(pad);
+	glm::vec2 graph_min = text_at + glm::vec2(0.0f, float(line_count) * line_height + pad);
+	glm::vec2 graph_max = graph_min + glm::vec2(graph_width, graph_height);
+
+	rect(corner, glm::vec2(corner.x + width + 2.0f * pad, graph_max.y + pad), glm::u8vec4(0x00, 0x00, 0x00, 0xb0));
+
+	for (uint32_t l = 0; l < line_count; ++l) {
+		text(text_at + glm::vec2(0.0f, float(l) * line_height), lines[l], glm::u8vec4(0xff, 0xff, 0xff, 0xff));
+	}
+
+	//graph: update and draw as stacked bars, with the whole frame as a line over them:
+	auto y_for = [&](float ms) {
+		return graph_max.y - std::min(ms, GraphMaxMs) / GraphMaxMs * graph_height;
+	};
+	rect(graph_min, graph_max, glm::u8vec4(0x20, 0x20, 0x20, 0xb0));
+	for (float ms : { 1000.0f / 60.0f, 1000.0f / 30.0f }) {
+		line(glm::vec2(graph_min.x, y_for(ms)), glm::vec2(graph_max.x, y_for(ms)), scale, glm::u8vec4(0xff, 0xff, 0xff, 0x40));
+	}
+	glm::vec2 previous;
+	for (uint32_t i = 0; i < history_count; ++i) {
+		//(newest at the right)
+		Frame const &frame = history[(history_next + HistorySize - history_count + i) % HistorySize];
+		float x = graph_max.x - float(history_count - i) * scale;
+		float update_top = y_for(frame.update_ms);
+		float draw_top = y_for(frame.update_ms + frame.draw_ms);
+		rect(glm::vec2(x, update_top), glm::vec2(x + scale, graph_max.y), glm::u8vec4(0x50, 0xd0, 0x50, 0xff));
+		rect(glm::vec2(x, draw_top), glm::vec2(x + scale, update_top), glm::u8vec4(0x50, 0x90, 0xff, 0xff));
+		glm::vec2 at = glm::vec2(x + 0.5f * scale, y_for(frame.frame_ms));
+		if (i > 0) line(previous, at, scale, glm::u8vec4(0xff, 0xff, 0xff, 0xff));
+		previous = at;
+	}
+	glm::vec2 legend = graph_min + glm::vec2(pad, pad);
+	text(legend, "update", glm::u8vec4(0x50, 0xd0, 0x50, 0xff));
+	text(legend + glm::vec2(7.0f * 6.0f * scale, 0.0f), "draw", glm::u8vec4(0x50, 0x90, 0xff, 0xff));
+	text(legend + glm::vec2(12.0f * 6.0f * scale, 0.0f), "frame", glm::u8vec4(0xff, 0xff, 0xff, 0xff));
+
+	//---- submit it ----
+	if (program == -1U) program = shaders.get(handle);
+
+	GLsizeiptr bytes = GLsizeiptr(vertices.size() * sizeof(Vertex));
+	stream->begin_frame(bytes);
+	void *data = nullptr;
+	GLintptr offset = stream->allocate(bytes, &data);
+	std::memcpy(data, vertices.data(), size_t(bytes));
+	stream->end_writes();
+
+	gl_state().bind_vertex_array(vao);
+	if (vao_generation != stream->generation) {
+		//(first draw, or the stream grew into a new buffer -- which may have the old one's name, so names aren't compared)
+		gl_state().bind_buffer(GL_ARRAY_BUFFER, stream->buffer);
+		PerfHUDLayout::bind(0, 1, 2);
+		vao_generation = stream->generation;
+	}
+	gl_state().use_program(program);
+	gl_state().set_enabled(GL_DEPTH_TEST, false);
+	gl_state().set_enabled(GL_BLEND, true);
+	gl_state().blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	glDrawArrays(GL_TRIANGLES, GLint(offset / GLintptr(sizeof(Vertex))), GLsizei(vertices.size()));
+
+	stream->end_frame();
+
+	draw_cpu_ms = std::chrono::duration< float, std::milli >(Clock::now() - begin).count();
+}
+
+uint64_t process_resident_bytes() {
+	#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+	return uint64_t(counters.WorkingSetSize);
+	#elif defined(__APPLE__)
+	mach_task_basic_info_data_t info;
+	mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+	if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) return 0;
+	return uint64_t(info.resident_size);
+	#else
+	//(second field of /proc/self/statm is resident pages)
+	FILE *statm = std::fopen("/proc/self/statm", "r");
+	if (!statm) return 0;
+	unsigned long long size = 0, resident = 0;
+	int read = std::fscanf(statm, "%llu %llu", &size, &resident);
+	std::fclose(statm);
+	if (read != 2) return 0;
+	return uint64_t(resident) * uint64_t(sysconf(_SC_PAGESIZE));
+	#endif
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "GL.hpp"
+#include "shader_manager.hpp"
+#include "stream_buffer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+//PerfHUD draws a performance overlay (F1 in dist/main) over the finished frame:
+// a graph of recent frame times, the update/draw/swap split, what was drawn,
+// and the process's memory use.
+//   hud.draw(drawable_size); //after Game::draw, before the swap
+//   ...swap...
+//   hud.add_frame(frame); //once the frame's times are known
+//
+//Everything -- text, graph lines, background -- is one batch of triangles,
+// streamed through a StreamBuffer and drawn with a single glDrawArrays. Text
+// uses a built-in 5x7 pixel font, stored as a constant array in the fragment
+// shader, so the overlay needs no textures. Text is rebuilt TextInterval frames
+// at a time (showing the average over those frames, so it's readable); only
+// the graph changes every frame.
+struct PerfHUD {
+	enum {
+		HistorySize = 240, //frames shown in the graph
+		TextInterval = 15, //frames averaged per text update
+	};
+
+	PerfHUD();
+	~PerfHUD();
+
+	PerfHUD(PerfHUD const &) = delete;
+	PerfHUD &operator=(PerfHUD const &) = delete;
+
+	//one frame's measurements (times in ms):
+	struct Frame {
+		float frame_ms = 0.0f;
+		float update_ms = 0.0f;
+		float draw_ms = 0.0f;
+		float swap_ms = 0.0f;
+		float gpu_ms = 0.0f; //(from GPUProfiler, a few frames late)
+		uint32_t draws = 0;
+		uint32_t triangles = 0;
+		uint32_t guards = 0;
+		uint32_t walls = 0;
+		uint32_t gl_calls = 0; //(only counted in GL_INSTRUMENT builds; 0 = not known)
+	};
+	void add_frame(Frame const &frame);
+
+	//draws the overlay into the bound framebuffer (whose viewport should be 'drawable_size'):
+	void draw(glm::uvec2 drawable_size);
+
+	//CPU time the last draw() took (shown in the overlay itself):
+	float draw_cpu_ms = 0.0f;
+
+	//-------- internals --------
+
+	//texel within a glyph's 6x8 cell, and the glyph (character - ' ', or SolidGlyph to fill the whole quad):
+	struct GlyphTexel {
+		uint8_t x, y, glyph, pad;
+	};
+	enum : uint8_t { SolidGlyph = 95 };
+
+	struct Vertex {
+		glm::vec2 Position; //(clip space)
+		GlyphTexel Glyph;
+		glm::u8vec4 Color;
+	};
+	static_assert(sizeof(Vertex) == 16, "PerfHUD::Vertex should be packed.");
+
+private:
+	//batch building (positions in pixels from the top left):
+	void rect(glm::vec2 min, glm::vec2 max, glm::u8vec4 color);
+	void line(glm::vec2 a, glm::vec2 b, float width, glm::u8vec4 color);
+	void text(glm::vec2 at, char const *str, glm::u8vec4 color);
+	void quad(glm::vec2 min, glm::vec2 max, uint8_t glyph, glm::u8vec4 color);
+
+	ShaderManager shaders;
+	ShaderManager::Handle handle = -1U;
+	GLuint program = -1U; //(-1U until first draw)
+
+	std::unique_ptr< StreamBuffer > stream;
+	GLuint vao = 0;
+	uint32_t vao_generation = 0; //stream->generation the vao's attributes point into (the stream makes a new buffer if it grows)
+
+	std::vector< Vertex > vertices; //this frame's batch
+	glm::vec2 to_clip = glm::vec2(0.0f); //pixels -> clip space scale
+	float scale = 1.0f; //pixels per font texel
+
+	//recent frames, for the graph:
+	Frame history[HistorySize];
+	uint32_t history_next = 0;
+	uint32_t history_count = 0;
+
+	//text lines, rebuilt every TextInterval frames:
+	enum { MaxLines = 8, LineLength = 64 };
+	char lines[MaxLines][LineLength];
+	uint32_t line_count = 0;
+	Frame interval_sum;
+	float interval_max_ms = 0.0f;
+	uint32_t interval_frames = 0;
+	void update_lines();
+	void print(char const *format, ...); //(adds a line)
+};
+
+//resident memory of this process, in bytes (0 if not known):
+uint64_t process_resident_bytes();
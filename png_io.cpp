@@ -0,0 +1,43 @@
+#include "png_io.hpp"
+
+#include <png.h>
+
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+void save_png(std::string const &filename, uint32_t width, uint32_t height, uint8_t const *rgba, bool bottom_up) {
+	FILE *fp = std::fopen(filename.c_str(), "wb");
+	if (!fp) throw std::runtime_error("Failed to open '" + filename + "' for writing.");
+
+	png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+	png_infop info = png ? png_create_info_struct(png) : nullptr;
+	if (!png || !info) {
+		png_destroy_write_struct(&png, &info);
+		std::fclose(fp);
+		throw std::runtime_error("Failed to create png writer.");
+	}
+
+	//(libpng reports errors by longjmp-ing back here)
+	if (setjmp(png_jmpbuf(png))) {
+		png_destroy_write_struct(&png, &info);
+		std::fclose(fp);
+		throw std::runtime_error("Failed to write '" + filename + "'.");
+	}
+
+	png_init_io(png, fp);
+	png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGBA, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	//(frames are written often, so favor speed over size)
+	png_set_compression_level(png, 1);
+
+	std::vector< png_bytep > rows(height);
+	for (uint32_t y = 0; y < height; ++y) {
+		uint32_t row = (bottom_up ? height - 1 - y : y);
+		rows[y] = const_cast< png_bytep >(rgba + size_t(row) * width * 4);
+	}
+	png_set_rows(png, info, rows.data());
+	png_write_png(png, info, PNG_TRANSFORM_IDENTITY, nullptr);
+
+	png_destroy_write_struct(&png, &info);
+	std::fclose(fp);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+//save_png writes an 8-bit RGBA image (rows packed, 4 bytes per pixel).
+//'bottom_up' is for data read back from OpenGL, whose first row is the bottom of the image.
+//Throws std::runtime_error on failure.
+void save_png(std::string const &filename, uint32_t width, uint32_t height, uint8_t const *rgba, bool bottom_up);
@@ -4,6 +4,8 @@
 #include <vector>
 #include <stdexcept>
 #include <cassert>
+#include <cstring>
+#include <cstdint>
 
 template< typename T >
 void read_chunk(std::istream &from, std::string const &magic, std::vector< T > *_to) {
@@ -33,3 +35,48 @@ void read_chunk(std::istream &from, std::string const &magic, std::vector< T > *
 		throw std::runtime_error("Failed to read chunk data.");
 	}
 }
+
+//---- in-place chunk access ----
+//For data that is already in memory (e.g., a MappedFile), chunks can be
+// validated and used where they are instead of being copied into vectors:
+//   char const *at = blob.begin();
+//   ChunkView data = read_chunk(&at, blob.end(), "dat0", sizeof(Vertex));
+
+struct ChunkView {
+	char const *data = nullptr;
+	uint32_t size = 0;
+};
+
+//peek_chunk_magic returns the magic number of the chunk starting at 'at'
+// (useful when a chunk may be stored in one of several formats):
+inline std::string peek_chunk_magic(char const *at, char const *end) {
+	if (end - at < 4) {
+		throw std::runtime_error("Failed to read chunk header");
+	}
+	return std::string(at, 4);
+}
+
+//read_chunk checks the chunk at *at against magic, element_size, and the end of the data,
+// then advances *at past the chunk:
+inline ChunkView read_chunk(char const **at, char const *end, std::string const &magic, size_t element_size = 1) {
+	assert(at); //(*at may be null: an empty file maps to nothing, and fails the size check below)
+	assert(element_size > 0);
+
+	if (end - *at < 8) {
+		throw std::runtime_error("Failed to read chunk header");
+	}
+	if (std::string(*at, 4) != magic) {
+		throw std::runtime_error("Unexpected magic number in chunk");
+	}
+	ChunkView chunk;
+	std::memcpy(&chunk.size, *at + 4, sizeof(chunk.size));
+	if (chunk.size % element_size != 0) {
+		throw std::runtime_error("Size of chunk not divisible by element size");
+	}
+	if (uint64_t(end - (*at + 8)) < chunk.size) {
+		throw std::runtime_error("Failed to read chunk data.");
+	}
+	chunk.data = *at + 8;
+	*at = chunk.data + chunk.size;
+	return chunk;
+}
@@ -0,0 +1,37 @@
+#include "render_list.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+//maps a float to an unsigned integer with the same ordering:
+static uint32_t sortable_bits(float value) {
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	//negative floats: flip all bits (larger magnitude sorts lower);
+	//positive floats: flip the sign bit (so they sort above negatives):
+	return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+void RenderList::add(uint8_t program, MeshHandle mesh, glm::mat4 const &object_to_world, float depth, bool transparent) {
+	uint64_t key;
+	if (!transparent) {
+		//[63] 0 | [62:55] program | [54:23] depth (near first) | [22:7] mesh
+		key = (uint64_t(program) << 55)
+		    | (uint64_t(sortable_bits(depth)) << 23)
+		    | (uint64_t(mesh & 0xffff) << 7);
+	} else {
+		//[63] 1 | [62:31] depth (far first) | [30:23] program | [22:7] mesh
+		key = (uint64_t(1) << 63)
+		    | (uint64_t(~sortable_bits(depth)) << 31)
+		    | (uint64_t(program) << 23)
+		    | (uint64_t(mesh & 0xffff) << 7);
+	}
+	commands.emplace_back(DrawCommand{ key, program, transparent, mesh, object_to_world });
+}
+
+void RenderList::sort() {
+	//(equal keys only happen for identical draws, so order among them doesn't matter)
+	std::sort(commands.begin(), commands.end(), [](DrawCommand const &a, DrawCommand const &b) {
+		return a.key < b.key;
+	});
+}
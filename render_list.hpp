@@ -0,0 +1,43 @@
+#pragma once
+
+#include "mesh_index.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+//RenderList collects the draws for a frame so they can be submitted in a
+// state- and depth-friendly order rather than the order the game thinks of them:
+//   list.clear();
+//   list.add(SimpleShadingProgram, wall_mesh, object_to_world, depth, false);
+//   ...
+//   list.sort();
+//   for (DrawCommand const &cmd : list.commands) { ...draw... }
+//
+//Commands are sorted by a 64-bit key:
+// - opaque draws come first, grouped by program, then front-to-back (so the
+//   depth test rejects hidden fragments before they are shaded), then by mesh
+//   (meshes share a vertex buffer, so switching between them costs nothing);
+// - transparent draws follow, back-to-front (so they blend correctly),
+//   with program and mesh only breaking ties.
+//'depth' is distance from the camera; any monotonic measure works.
+//
+//The command vector keeps its capacity across clear(), so steady-state frames
+// don't allocate.
+
+struct DrawCommand {
+	uint64_t key;
+	uint8_t program; //index into the renderer's program table
+	bool transparent;
+	MeshHandle mesh;
+	glm::mat4 object_to_world;
+};
+
+struct RenderList {
+	void clear() { commands.clear(); }
+	void add(uint8_t program, MeshHandle mesh, glm::mat4 const &object_to_world, float depth, bool transparent);
+	void sort();
+
+	std::vector< DrawCommand > commands;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+//SampleStats summarizes a set of timing samples (e.g., frame times in ms):
+struct SampleStats {
+	size_t count = 0;
+	float mean = 0.0f;
+	float p50 = 0.0f;
+	float p95 = 0.0f;
+	float p99 = 0.0f;
+	float max = 0.0f;
+};
+
+//(takes samples by value, since they get sorted)
+inline SampleStats summarize(std::vector< float > samples) {
+	SampleStats stats;
+	stats.count = samples.size();
+	if (samples.empty()) return stats;
+	std::sort(samples.begin(), samples.end());
+	double sum = 0.0;
+	for (float s : samples) sum += s;
+	stats.mean = float(sum / samples.size());
+	//nearest-rank percentiles:
+	auto percentile = [&samples](float p) {
+		size_t rank = size_t(p * samples.size() + 0.5f);
+		if (rank > 0) rank -= 1;
+		return samples[std::min(rank, samples.size() - 1)];
+	};
+	stats.p50 = percentile(0.50f);
+	stats.p95 = percentile(0.95f);
+	stats.p99 = percentile(0.99f);
+	stats.max = samples.back();
+	return stats;
+}
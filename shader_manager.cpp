@@ -0,0 +1,259 @@
+#include "shader_manager.hpp"
+
+#include <SDL.h>
+
+#include "read_chunk.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+//GL_KHR_parallel_shader_compile shares its enum (and entry point signature) with the ARB version:
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSPROC) (GLuint count);
+
+static GLuint start_shader(GLenum type, std::string const &source);
+static std::string shader_info_log(GLuint shader);
+static std::string program_info_log(GLuint program);
+static std::string hash_hex(std::string const &data);
+
+ShaderManager::ShaderManager(std::string const &cache_directory_) {
+	PFNGLMAXSHADERCOMPILERTHREADSPROC max_compiler_threads = nullptr;
+	if (SDL_GL_ExtensionSupported("GL_KHR_parallel_shader_compile")) {
+		max_compiler_threads = (PFNGLMAXSHADERCOMPILERTHREADSPROC)SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsKHR");
+	} else if (SDL_GL_ExtensionSupported("GL_ARB_parallel_shader_compile")) {
+		max_compiler_threads = (PFNGLMAXSHADERCOMPILERTHREADSPROC)SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsARB");
+	}
+	if (max_compiler_threads) {
+		parallel_compile = true;
+		//let the driver pick how many threads to use:
+		max_compiler_threads(0xFFFFFFFFU);
+	}
+
+	bool use_cache = (cache_directory_ != "");
+	#ifdef GL_TRACE
+	//(program binaries only load on the driver that made them, but traces should replay anywhere)
+	use_cache = false;
+	#endif
+	if (use_cache && SDL_GL_ExtensionSupported("GL_ARB_get_program_binary")) {
+		program_parameteri = (ProgramParameteriProc)SDL_GL_GetProcAddress("glProgramParameteri");
+		get_program_binary = (GetProgramBinaryProc)SDL_GL_GetProcAddress("glGetProgramBinary");
+		program_binary = (ProgramBinaryProc)SDL_GL_GetProcAddress("glProgramBinary");
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		if (program_parameteri && get_program_binary && program_binary && formats > 0) {
+			#if defined(_WIN32)
+			_mkdir(cache_directory_.c_str());
+			#else
+			mkdir(cache_directory_.c_str(), 0755);
+			#endif
+			cache_directory = cache_directory_;
+			auto get_string = [](GLenum name) -> std::string {
+				GLubyte const *str = glGetString(name);
+				return str ? reinterpret_cast< char const * >(str) : "";
+			};
+			driver = get_string(GL_VENDOR) + '\n' + get_string(GL_RENDERER) + '\n' + get_string(GL_VERSION);
+		}
+	}
+}
+
+ShaderManager::~ShaderManager() {
+	for (Program &p : programs) {
+		if (p.vertex_shader) glDeleteShader(p.vertex_shader);
+		if (p.fragment_shader) glDeleteShader(p.fragment_shader);
+		glDeleteProgram(p.program);
+	}
+	programs.clear();
+}
+
+ShaderManager::Handle ShaderManager::submit(std::string const &name, std::string const &vertex_source, std::string const &fragment_source) {
+	Program p;
+	p.name = name;
+
+	if (cache_directory != "") {
+		p.cache_file = cache_directory + "/" + hash_hex(vertex_source + '\0' + fragment_source + '\0' + driver) + ".bin";
+		p.program = glCreateProgram();
+		if (load_binary(p)) {
+			++cache_hits;
+			p.cache_file = ""; //(already cached)
+			p.checked = true;
+			programs.emplace_back(p);
+			return Handle(programs.size() - 1);
+		}
+		++cache_misses;
+		//start over with a clean program object, since the driver may have rejected the binary:
+		glDeleteProgram(p.program);
+	}
+
+	p.vertex_shader = start_shader(GL_VERTEX_SHADER, vertex_source);
+	p.fragment_shader = start_shader(GL_FRAGMENT_SHADER, fragment_source);
+
+	p.program = glCreateProgram();
+	glAttachShader(p.program, p.vertex_shader);
+	glAttachShader(p.program, p.fragment_shader);
+	if (p.cache_file != "") {
+		program_parameteri(p.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	//(link status -- and compile status, if it fails -- is checked in get())
+	glLinkProgram(p.program);
+
+	programs.emplace_back(p);
+	return Handle(programs.size() - 1);
+}
+
+bool ShaderManager::ready(Handle handle) const {
+	Program const &p = programs.at(handle);
+	if (p.checked || !parallel_compile) return true;
+	GLint done = GL_FALSE;
+	glGetProgramiv(p.program, GL_COMPLETION_STATUS_KHR, &done);
+	return done == GL_TRUE;
+}
+
+GLuint ShaderManager::get(Handle handle) {
+	Program &p = programs.at(handle);
+	if (p.checked) return p.program;
+
+	GLint link_status = GL_FALSE;
+	glGetProgramiv(p.program, GL_LINK_STATUS, &link_status);
+	if (link_status != GL_TRUE) {
+		//report compile errors first, since they are the usual cause of link errors:
+		GLuint shaders[2] = { p.vertex_shader, p.fragment_shader };
+		for (GLuint shader : shaders) {
+			GLint compile_status = GL_FALSE;
+			glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_status);
+			if (compile_status != GL_TRUE) {
+				std::cerr << "Failed to compile shader for program '" << p.name << "'." << std::endl;
+				std::cerr << "Info log: " << shader_info_log(shader);
+			}
+		}
+		std::cerr << "Failed to link shader program '" << p.name << "'." << std::endl;
+		std::cerr << "Info log: " << program_info_log(p.program);
+		throw std::runtime_error("failed to link program '" + p.name + "'");
+	}
+
+	//shaders are reference counted, so this makes sure they are freed with the program:
+	glDeleteShader(p.vertex_shader);
+	glDeleteShader(p.fragment_shader);
+	p.vertex_shader = 0;
+	p.fragment_shader = 0;
+	p.checked = true;
+
+	if (p.cache_file != "") {
+		save_binary(p);
+	}
+
+	return p.program;
+}
+
+//Cached programs are stored as two chunks (see read_chunk.hpp):
+//  'fmt0' -- the binary format (one GLenum)
+//  'bin0' -- the program binary
+
+bool ShaderManager::load_binary(Program &p) {
+	std::ifstream file(p.cache_file, std::ios::binary);
+	if (!file.is_open()) return false;
+	std::vector< GLenum > format;
+	std::vector< char > binary;
+	try {
+		read_chunk(file, "fmt0", &format);
+		read_chunk(file, "bin0", &binary);
+	} catch (std::runtime_error &e) {
+		std::cerr << "WARNING: ignoring invalid program cache file '" << p.cache_file << "' (" << e.what() << ")." << std::endl;
+		return false;
+	}
+	if (format.size() != 1 || binary.empty()) return false;
+
+	program_binary(p.program, format[0], binary.data(), GLsizei(binary.size()));
+	GLint link_status = GL_FALSE;
+	glGetProgramiv(p.program, GL_LINK_STATUS, &link_status);
+	//(the driver may reject binaries from, e.g., an older build of itself that reported the same version string)
+	return link_status == GL_TRUE;
+}
+
+void ShaderManager::save_binary(Program const &p) {
+	GLint length = 0;
+	glGetProgramiv(p.program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) return;
+	std::vector< char > binary(length);
+	GLenum format = 0;
+	GLsizei got = 0;
+	get_program_binary(p.program, length, &got, &format, binary.data());
+	if (got <= 0) return;
+	binary.resize(got);
+
+	auto write_chunk = [](std::ostream &to, char const *magic, void const *data, uint32_t size) {
+		to.write(magic, 4);
+		to.write(reinterpret_cast< char const * >(&size), sizeof(size));
+		to.write(reinterpret_cast< char const * >(data), size);
+	};
+
+	//written to a temporary file and renamed, so a partly-written file is never loaded:
+	std::string temp = p.cache_file + ".tmp";
+	{
+		std::ofstream file(temp, std::ios::binary);
+		write_chunk(file, "fmt0", &format, sizeof(format));
+		write_chunk(file, "bin0", binary.data(), uint32_t(binary.size()));
+		if (!file) {
+			std::cerr << "WARNING: failed to write program cache file '" << temp << "'." << std::endl;
+			return;
+		}
+	}
+	std::remove(p.cache_file.c_str());
+	if (std::rename(temp.c_str(), p.cache_file.c_str()) != 0) {
+		std::cerr << "WARNING: failed to rename '" << temp << "' to '" << p.cache_file << "'." << std::endl;
+		std::remove(temp.c_str());
+	}
+}
+
+//create an OpenGL shader and start compiling it (without waiting for the result):
+static GLuint start_shader(GLenum type, std::string const &source) {
+	GLuint shader = glCreateShader(type);
+	GLchar const *str = source.c_str();
+	GLint length = GLint(source.size());
+	glShaderSource(shader, 1, &str, &length);
+	glCompileShader(shader);
+	return shader;
+}
+
+static std::string shader_info_log(GLuint shader) {
+	GLint info_log_length = 0;
+	glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &info_log_length);
+	std::vector< GLchar > info_log(info_log_length + 1, 0);
+	GLsizei length = 0;
+	glGetShaderInfoLog(shader, GLsizei(info_log.size()), &length, &info_log[0]);
+	return std::string(info_log.begin(), info_log.begin() + length);
+}
+
+static std::string program_info_log(GLuint program) {
+	GLint info_log_length = 0;
+	glGetProgramiv(program, GL_INFO_LOG_LENGTH, &info_log_length);
+	std::vector< GLchar > info_log(info_log_length + 1, 0);
+	GLsizei length = 0;
+	glGetProgramInfoLog(program, GLsizei(info_log.size()), &length, &info_log[0]);
+	return std::string(info_log.begin(), info_log.begin() + length);
+}
+
+//64-bit FNV-1a hash, as hex:
+static std::string hash_hex(std::string const &data) {
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (char c : data) {
+		hash ^= uint8_t(c);
+		hash *= 0x100000001b3ULL;
+	}
+	char hex[17];
+	for (int i = 0; i < 16; ++i) {
+		hex[i] = "0123456789abcdef"[(hash >> (60 - 4 * i)) & 0xf];
+	}
+	hex[16] = '\0';
+	return hex;
+}
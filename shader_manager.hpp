@@ -0,0 +1,77 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//ShaderManager compiles and links shader programs without waiting on them:
+// submit() issues every compile and link call right away, and nothing queries
+// compile/link status until the program is first needed by get().
+//
+//Drivers that support KHR_parallel_shader_compile (or the ARB version) compile
+// submitted programs on background threads, and ready() can be polled without
+// blocking. Other drivers compile lazily or synchronously, but either way the
+// application only stalls on a program when it actually needs it.
+//
+//   ShaderManager shaders;
+//   ShaderManager::Handle lit = shaders.submit("lit", vertex_source, fragment_source);
+//   ... (upload meshes, etc) ...
+//   glUseProgram(shaders.get(lit));
+//
+//If given a cache directory (and the driver supports ARB_get_program_binary),
+// linked programs are saved there with glGetProgramBinary, keyed by a hash of
+// their sources and the driver's vendor/renderer/version strings. Later runs
+// load them with glProgramBinary and only compile from source on a miss (or if
+// the driver rejects the cached binary).
+struct ShaderManager {
+	typedef uint32_t Handle;
+
+	//cache_directory is created if needed; "" disables the program binary cache:
+	explicit ShaderManager(std::string const &cache_directory = "");
+	~ShaderManager(); //deletes all programs
+
+	ShaderManager(ShaderManager const &) = delete;
+	ShaderManager &operator=(ShaderManager const &) = delete;
+
+	//start compiling and linking a program (returns immediately):
+	Handle submit(std::string const &name, std::string const &vertex_source, std::string const &fragment_source);
+
+	//has the driver finished with this program? (never blocks; always true without parallel compile support):
+	bool ready(Handle handle) const;
+
+	//the linked program; blocks until it is done, and throws (with info logs on std::cerr) if it failed:
+	GLuint get(Handle handle);
+
+	//was KHR/ARB_parallel_shader_compile available?
+	bool parallel_compile = false;
+
+	//program binary cache state and statistics:
+	std::string cache_directory; //"" if the cache is disabled (or unsupported)
+	uint32_t cache_hits = 0;
+	uint32_t cache_misses = 0;
+
+private:
+	struct Program {
+		std::string name;
+		GLuint program = 0;
+		GLuint vertex_shader = 0;
+		GLuint fragment_shader = 0;
+		bool checked = false; //link status has been checked
+		std::string cache_file; //where to save the linked binary ("" to not save)
+	};
+	bool load_binary(Program &p);
+	void save_binary(Program const &p);
+
+	std::vector< Program > programs;
+	std::string driver; //vendor + renderer + version, part of every cache key
+
+	//ARB_get_program_binary entry points (core in 4.1, so looked up at runtime):
+	typedef void (APIENTRYP ProgramParameteriProc) (GLuint program, GLenum pname, GLint value);
+	typedef void (APIENTRYP GetProgramBinaryProc) (GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+	typedef void (APIENTRYP ProgramBinaryProc) (GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+	ProgramParameteriProc program_parameteri = nullptr;
+	GetProgramBinaryProc get_program_binary = nullptr;
+	ProgramBinaryProc program_binary = nullptr;
+};
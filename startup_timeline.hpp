@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//StartupTimeline records named spans of work (from any thread) between program
+// start and the first frame, and reports them as a time-to-first-frame breakdown:
+//   StartupTimeline timeline;
+//   { StartupTimeline::Scope scope(timeline, "sdl init", "main"); SDL_Init(...); }
+//   ...
+//   timeline.report(std::cout);
+struct StartupTimeline {
+	typedef std::chrono::high_resolution_clock Clock;
+
+	struct Span {
+		std::string name;
+		std::string thread;
+		float begin_ms;
+		float end_ms;
+	};
+
+	//records [begin, end) as a span named 'name' on thread 'thread':
+	void record(std::string const &name, std::string const &thread, Clock::time_point begin, Clock::time_point end) {
+		std::lock_guard< std::mutex > lock(mutex);
+		spans.emplace_back(Span{ name, thread, ms_since_start(begin), ms_since_start(end) });
+	}
+
+	//records the lifetime of the Scope object as a span:
+	struct Scope {
+		Scope(StartupTimeline &timeline_, std::string const &name_, std::string const &thread_)
+			: timeline(timeline_), name(name_), thread(thread_), begin(Clock::now()) { }
+		~Scope() { timeline.record(name, thread, begin, Clock::now()); }
+		StartupTimeline &timeline;
+		std::string name;
+		std::string thread;
+		Clock::time_point begin;
+	};
+
+	//prints every span (in the order they started) and the total time since start:
+	void report(std::ostream &out) {
+		float total = ms_since_start(Clock::now());
+		std::lock_guard< std::mutex > lock(mutex);
+		std::vector< Span > sorted = spans;
+		std::stable_sort(sorted.begin(), sorted.end(), [](Span const &a, Span const &b) {
+			return a.begin_ms < b.begin_ms;
+		});
+		out << "Startup: " << std::fixed << std::setprecision(1) << total << "ms to first frame." << std::endl;
+		for (Span const &s : sorted) {
+			out << "  " << std::left << std::setw(24) << s.name << std::right
+				<< std::setw(8) << (s.end_ms - s.begin_ms) << "ms"
+				<< "  [" << std::setw(7) << s.begin_ms << " - " << std::setw(7) << s.end_ms << "]"
+				<< "  (" << s.thread << ")" << std::endl;
+		}
+		out.unsetf(std::ios::floatfield);
+		out << std::setprecision(6);
+	}
+
+	Clock::time_point start = Clock::now();
+
+private:
+	float ms_since_start(Clock::time_point t) const {
+		return std::chrono::duration< float, std::milli >(t - start).count();
+	}
+	std::mutex mutex;
+	std::vector< Span > spans;
+};
@@ -0,0 +1,146 @@
+#include "stream_buffer.hpp"
+
+#include "gl_state.hpp"
+
+#include <SDL.h>
+
+#include <chrono>
+#include <stdexcept>
+
+StreamBuffer::StreamBuffer(GLenum target_, GLsizeiptr region_size_, GLsizeiptr alignment_) : target(target_), alignment(alignment_) {
+	if (alignment < 1) alignment = 1;
+	for (uint32_t i = 0; i < Regions; ++i) {
+		fences[i] = 0;
+	}
+	create(aligned(region_size_));
+}
+
+StreamBuffer::~StreamBuffer() {
+	destroy();
+}
+
+void StreamBuffer::create(GLsizeiptr region_size_) {
+	++generation;
+	region_size = region_size_;
+	region = 0;
+	reserved = 0;
+	used = 0;
+
+	PFNGLBUFFERSTORAGEPROC buffer_storage = nullptr;
+	#ifndef GL_TRACE //(traces record what was written to a mapping at glUnmapBuffer, so need the per-frame path)
+	if (SDL_GL_ExtensionSupported("GL_ARB_buffer_storage")) {
+		buffer_storage = (PFNGLBUFFERSTORAGEPROC)SDL_GL_GetProcAddress("glBufferStorage");
+	}
+	#endif
+
+	glGenBuffers(1, &buffer);
+	gl_state().bind_buffer(target, buffer);
+	if (buffer_storage) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		buffer_storage(target, Regions * region_size, nullptr, flags);
+		mapped = (char *)glMapBufferRange(target, 0, Regions * region_size, flags);
+		if (!mapped) throw std::runtime_error("StreamBuffer: failed to persistently map buffer.");
+		persistent = true;
+	} else {
+		glBufferData(target, Regions * region_size, nullptr, GL_STREAM_DRAW);
+		mapped = nullptr;
+		persistent = false;
+	}
+}
+
+void StreamBuffer::destroy() {
+	for (uint32_t i = 0; i < Regions; ++i) {
+		if (fences[i]) glDeleteSync(fences[i]);
+		fences[i] = 0;
+	}
+	if (buffer) {
+		if (mapped) {
+			gl_state().bind_buffer(target, buffer);
+			glUnmapBuffer(target);
+			mapped = nullptr;
+		}
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+		//deleting a bound buffer unbinds it:
+		gl_state().invalidate();
+	}
+}
+
+void StreamBuffer::begin_frame(GLsizeiptr bytes_needed) {
+	frame = Counters();
+
+	if (bytes_needed > region_size) {
+		//(rare -- e.g., a bigger level) wait for the GPU to be done with every region and start over, bigger:
+		glFinish();
+		destroy();
+		GLsizeiptr size = region_size;
+		while (size < bytes_needed) size *= 2;
+		create(aligned(size));
+	} else {
+		region = (region + 1) % Regions;
+	}
+	reserved = bytes_needed;
+	used = 0;
+
+	//wait for the GPU to finish the draws that last read this region:
+	if (fences[region]) {
+		GLenum result = glClientWaitSync(fences[region], 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED) {
+			++frame.fence_waits;
+			auto before = std::chrono::high_resolution_clock::now();
+			do {
+				result = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); //1ms
+			} while (result == GL_TIMEOUT_EXPIRED);
+			frame.fence_wait_ms += std::chrono::duration< double, std::milli >(std::chrono::high_resolution_clock::now() - before).count();
+		}
+		glDeleteSync(fences[region]);
+		fences[region] = 0;
+	}
+
+	if (!persistent && bytes_needed > 0) {
+		//the fence wait above is the synchronization, so the driver needn't do any:
+		gl_state().bind_buffer(target, buffer);
+		mapped = (char *)glMapBufferRange(target, region * region_size, bytes_needed,
+			GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+		if (!mapped) throw std::runtime_error("StreamBuffer: failed to map region.");
+	}
+}
+
+GLintptr StreamBuffer::allocate(GLsizeiptr size, void **data) {
+	GLsizeiptr at = used;
+	used += aligned(size);
+	if (used > reserved) throw std::runtime_error("StreamBuffer: allocated more than begin_frame reserved.");
+	frame.bytes_streamed += size;
+	if (persistent) {
+		*data = mapped + region * region_size + at;
+	} else {
+		*data = mapped + at;
+	}
+	return region * region_size + at;
+}
+
+void StreamBuffer::end_writes() {
+	if (!persistent && mapped) {
+		gl_state().bind_buffer(target, buffer);
+		glUnmapBuffer(target);
+		mapped = nullptr;
+	}
+}
+
+void StreamBuffer::end_frame() {
+	end_writes();
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	total.bytes_streamed += frame.bytes_streamed;
+	total.fence_waits += frame.fence_waits;
+	total.fence_wait_ms += frame.fence_wait_ms;
+	++frames;
+}
+
+void StreamBuffer::report(std::ostream &out) const {
+	if (frames == 0) return;
+	out << "Streamed " << double(total.bytes_streamed) / frames << " bytes per frame ("
+	    << (persistent ? "persistent" : "unsynchronized") << " mapping); "
+	    << total.fence_waits << " fence waits totaling " << total.fence_wait_ms << "ms over "
+	    << frames << " frames." << std::endl;
+}
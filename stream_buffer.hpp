@@ -0,0 +1,76 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <cstdint>
+#include <iostream>
+
+//StreamBuffer is a ring of per-frame regions in one buffer object, for data
+// that is rewritten every frame (e.g., per-object uniforms):
+//   stream.begin_frame(bytes_needed); //wait for this frame's region to be free
+//   GLintptr offset = stream.allocate(sizeof(Data), &ptr); ...write to ptr...
+//   stream.end_writes(); //(before any draw reads the data)
+//   ...draws using [offset, offset + size)...
+//   stream.end_frame(); //fence the region
+//
+//Each region is guarded by a fence placed after the frame's draws. Rewriting a
+// region only waits on that fence -- which passed long ago unless the GPU is
+// more than Regions frames behind -- so writes never stall on an implicit sync.
+//
+//With GL_ARB_buffer_storage the buffer is mapped once, persistently and
+// coherently, and written in place. Otherwise (plain GL 3.3) each frame maps its
+// region with UNSYNCHRONIZED | INVALIDATE_RANGE: the fences provide the
+// synchronization the driver is told to skip.
+struct StreamBuffer {
+	enum { Regions = 3 };
+
+	//'alignment' is the required alignment of allocations (e.g., GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT):
+	StreamBuffer(GLenum target, GLsizeiptr region_size, GLsizeiptr alignment = 16);
+	~StreamBuffer();
+
+	StreamBuffer(StreamBuffer const &) = delete;
+	StreamBuffer &operator=(StreamBuffer const &) = delete;
+
+	//waits (if needed) for the next region and makes it writable;
+	//regions grow (after waiting for the GPU) if 'bytes_needed' doesn't fit:
+	void begin_frame(GLsizeiptr bytes_needed);
+	//returns the buffer offset of 'size' bytes in the current region and sets '*data' to point at them:
+	GLintptr allocate(GLsizeiptr size, void **data);
+	//bytes allocate() will use for 'size' bytes (for computing begin_frame's 'bytes_needed'):
+	GLsizeiptr aligned(GLsizeiptr size) const { return (size + alignment - 1) / alignment * alignment; }
+	//makes written data available to GL (unmaps, if not persistently mapped):
+	void end_writes();
+	//fences the region once the frame's draws have been issued:
+	void end_frame();
+
+	GLenum target;
+	GLuint buffer = 0;
+	//counts buffers made (regions growing makes a new one, which may reuse the old one's name),
+	// so state that refers to 'buffer' -- like a VAO's attribute pointers -- can tell when to be redone:
+	uint32_t generation = 0;
+	bool persistent = false; //mapped once with ARB_buffer_storage?
+
+	struct Counters {
+		uint64_t bytes_streamed = 0;
+		uint64_t fence_waits = 0; //times begin_frame found the GPU still using the region
+		double fence_wait_ms = 0.0;
+	};
+	Counters frame; //counts for the current frame (reset in begin_frame)
+	Counters total;
+	uint64_t frames = 0;
+
+	//print per-frame averages:
+	void report(std::ostream &out) const;
+
+private:
+	void create(GLsizeiptr region_size);
+	void destroy();
+
+	GLsizeiptr region_size = 0;
+	GLsizeiptr alignment = 16;
+	uint32_t region = 0; //current region
+	GLsizeiptr reserved = 0; //bytes begin_frame made writable in the current region
+	GLsizeiptr used = 0; //bytes allocated in the current region
+	char *mapped = nullptr; //start of the current region's mapping (or the whole buffer, if persistent)
+	GLsync fences[Regions];
+};
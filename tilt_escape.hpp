@@ -1,6 +1,8 @@
 #pragma once
 
 #include "data_path.hpp"
+#include "asset_pack.hpp"
+#include "cpu_profiler.hpp"
 
 #include "GL.hpp"
 
@@ -13,8 +15,10 @@
 #include <random>
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
-#include <deque>
 #include <tuple>
+#include <memory>
+#include <stdexcept>
+#include <cctype>
 
 
 
@@ -110,7 +114,12 @@ namespace TiltEscape
         float wait_thresh;
         float time_at_waypoint;
         glm::vec2 velocity;
-        std::deque<glm::vec2> waypoints;
+        // Waypoints are visited in order, then again from the first
+        // (kept in place, so patrolling never allocates)
+        enum { MaxWaypoints = 16 };
+        glm::vec2 waypoints[MaxWaypoints];
+        uint32_t waypoint_count = 0;
+        uint32_t waypoint_index = 0;
 
         Guard(glm::vec2 _position, float _radius, GuardVision _fov)
         : Entity(_position)
@@ -126,6 +135,17 @@ namespace TiltEscape
             guard_id = -1;
         }
 
+        // Returns false if the guard already has MaxWaypoints
+        bool add_waypoint(glm::vec2 waypoint)
+        {
+            if (waypoint_count >= MaxWaypoints)
+            {
+                return false;
+            }
+            waypoints[waypoint_count++] = waypoint;
+            return true;
+        }
+
         void update(float elapsed)
         {
             // Always update the velocity
@@ -139,9 +159,8 @@ namespace TiltEscape
                 if (time_at_waypoint >= wait_thresh)
                 {
                     // Get the next waypoint
-                    next_waypoint = waypoints.front();
-                    waypoints.pop_front();
-                    waypoints.push_back(next_waypoint);
+                    next_waypoint = waypoints[waypoint_index];
+                    waypoint_index = (waypoint_index + 1) % waypoint_count;
 
                     //start moving to next waypoint
                     velocity = next_waypoint - current_waypoint;
@@ -269,8 +288,11 @@ namespace TiltEscape
 
     struct Level  {
 
-        // Stores the string representation
-        std::vector<std::vector<char>> level_matrix;
+        // Stores the string representation, row after row, each row
+        // get_length() wide (rows shorter than the first are padded with spaces)
+        std::vector<char> level_matrix;
+        uint32_t length = 0;
+        uint32_t height = 0;
         // All the walls in the level
         std::vector<Wall> walls;
         // Reference to the player
@@ -285,70 +307,93 @@ namespace TiltEscape
         }
 
         // Returns 2D array of char from file
-        void load_level(std::string filename)
+        void load_level(std::string const &filename)
         {
-            const glm::vec2 WALL_SIZE = glm::vec2(1,1);
-
-            std::ifstream mapfile(data_path(filename));
-            if (!mapfile.is_open())
+            PROFILE_SCOPE("load level");
+            // Map files may be loose in dist/ or packed into assets.pak
+            std::unique_ptr<Asset> mapfile;
+            try
+            {
+                mapfile = load_asset(filename);
+            }
+            catch (std::runtime_error &e)
             {
                 std::cerr << "failed to open " << filename << '\n';
+                return;
             }
-            else
+            parse_level(mapfile->begin(), mapfile->end());
+        }
+
+        // Builds the level from the characters of a map file
+        // (after clear_level, this reuses the containers' memory, so reloading
+        // a level no bigger than one loaded before doesn't allocate)
+        void parse_level(const char *begin, const char *end)
+        {
+            const glm::vec2 WALL_SIZE = glm::vec2(1,1);
+
+            while (begin < end)
             {
-                
-                std::string line;
-                
-                while (std::getline(mapfile, line))
+                const char *line = begin;
+                const char *line_end = std::find(begin, end, '\n');
+                begin = (line_end < end ? line_end + 1 : end);
+                uint32_t line_length = uint32_t(line_end - line);
+
+                // The first row sets the width of the level
+                if (height == 0)
+                {
+                    length = line_length;
+                }
+
+                for (uint32_t i = 0; i < line_length; i++)
                 {
-                    std::vector<char> row;
-                    for (uint32_t i = 0; i < line.length(); i++)
+                    if (line[i] == '#')
                     {
-                        if (line[i] == '#')
-                        {
-                            // Create a new wall
-                            walls.push_back(Wall(glm::vec2(i, level_matrix.size()), WALL_SIZE));
-                        }
-                        if (line[i] == 'P')
-                        {
-                            // Creates a new Player
-                            player = Player(glm::vec2(i, level_matrix.size()), 0.5f);
-                        }
-                        if (line[i] == 'H')
-                        {
-                            // Create a new hole in he board
-                            holes.push_back(glm::vec2(i, level_matrix.size()));
-                        }
-                        if (std::isdigit(line[i]))
+                        // Create a new wall
+                        walls.push_back(Wall(glm::vec2(i, height), WALL_SIZE));
+                    }
+                    if (line[i] == 'P')
+                    {
+                        // Creates a new Player
+                        player = Player(glm::vec2(i, height), 0.5f);
+                    }
+                    if (line[i] == 'H')
+                    {
+                        // Create a new hole in he board
+                        holes.push_back(glm::vec2(i, height));
+                    }
+                    if (std::isdigit(line[i]))
+                    {
+                        // I use numbers to denote the guards
+                        int guard_id = line[i] - '0';
+                        int guard_index = get_guard_index(guard_id);
+                        if (guard_index >= 0)
                         {
-                            // I use numbers to denote the guards
-                            int guard_id = line[i] - '0';
-                            int guard_index = get_guard_index(guard_id);
-                            if (guard_index >= 0)
+                            // Add this to the guards list of waypoints
+                            if (!guards[guard_index].add_waypoint(glm::vec2(i, height)))
                             {
-                                // Add this to the guards queue of waypoints
-                                guards[guard_index].waypoints.push_back(glm::vec2(i, level_matrix.size()));
-                            }
-                            else
-                            {
-                                // Create a new guard and add this as a waypoint
-                                Guard new_guard(glm::vec2(i, level_matrix.size()), 0.5f, GuardVision());
-                                new_guard.guard_id = guard_id;
-                                new_guard.current_waypoint = glm::vec2(i, level_matrix.size());
-                                new_guard.next_waypoint = glm::vec2(i, level_matrix.size());
-                                new_guard.waypoints.push_back(glm::vec2(i, level_matrix.size()));
-                                guards.push_back(new_guard);
+                                std::cerr << "guard " << guard_id << " has more than " << int(Guard::MaxWaypoints) << " waypoints; ignoring the rest\n";
                             }
                         }
-
-                        row.push_back(line[i]);
-                        
+                        else
+                        {
+                            // Create a new guard and add this as a waypoint
+                            Guard new_guard(glm::vec2(i, height), 0.5f, GuardVision());
+                            new_guard.guard_id = guard_id;
+                            new_guard.current_waypoint = glm::vec2(i, height);
+                            new_guard.next_waypoint = glm::vec2(i, height);
+                            new_guard.add_waypoint(glm::vec2(i, height));
+                            guards.push_back(new_guard);
+                        }
                     }
-                    level_matrix.push_back(row);
-
                 }
-                //std::reverse(std::begin(level_matrix), std::end(level_matrix));
+
+                // Keep the row (cut or padded to the level's width)
+                uint32_t kept = std::min(line_length, length);
+                level_matrix.insert(level_matrix.end(), line, line + kept);
+                level_matrix.insert(level_matrix.end(), length - kept, ' ');
+                height++;
             }
+            //std::reverse(std::begin(level_matrix), std::end(level_matrix));
         }
 
         bool has_guard(int guard_id)
@@ -378,6 +423,8 @@ namespace TiltEscape
         void clear_level()
         {
             level_matrix.clear();
+            length = 0;
+            height = 0;
             walls.clear();
             guards.clear();
             holes.clear();
@@ -386,24 +433,21 @@ namespace TiltEscape
 
         int get_length()
         {
-            if (!level_matrix.empty()) {
-                return level_matrix[0].size();
-            }
-            return 0;
+            return length;
         }
 
         int get_height()
         {
-            return level_matrix.size();
+            return height;
         }
 
         void print()
         {
-            for (Uint32 i = 0; i < level_matrix.size(); i++)
+            for (Uint32 i = 0; i < height; i++)
             {
-                for (Uint32 j = 0; j < level_matrix[i].size(); j++)
+                for (Uint32 j = 0; j < length; j++)
                 {
-                    std::cout << level_matrix[i][j];
+                    std::cout << level_matrix[i * length + j];
                 }
                 std::cout << std::endl;
             }
@@ -412,10 +456,10 @@ namespace TiltEscape
         char at(int row, int col) {
             if (row >= 0 && col >= 0)
             {
-                if ((Uint32)row < level_matrix.size() && 
-                    (Uint32)col < level_matrix[0].size())
+                if ((Uint32)row < height && 
+                    (Uint32)col < length)
                 {
-                    return level_matrix[row][col];
+                    return level_matrix[row * length + col];
                 }
                 return '\0';
             }
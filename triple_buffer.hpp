@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+//TripleBuffer hands the newest value of a T from one writer thread to one
+// reader thread without locks and without either side ever waiting:
+//   //writer:
+//   Snapshot &s = buffer.write_buffer(); ...fill s...; buffer.publish();
+//   //reader:
+//   Snapshot const &s = buffer.read(); //newest published (or same as last time)
+//
+//There are three slots: the writer owns 'back', the reader owns 'front', and
+// 'middle' holds the most recently published value. publish() and read() each
+// swap their slot with 'middle' in a single atomic exchange. The reader may skip
+// values (if the writer publishes faster than it reads) or see one twice.
+//
+//Slots are reused rather than reallocated, so a T that holds containers keeps
+// their capacity from one publish to the next.
+template< typename T >
+struct TripleBuffer {
+	//writer side -- the slot to fill before the next publish():
+	T &write_buffer() { return slots[back]; }
+	void publish() {
+		uint8_t previous = middle.exchange(uint8_t(back | Fresh), std::memory_order_acq_rel);
+		back = previous & IndexMask;
+	}
+
+	//reader side -- the most recently published value:
+	T const &read() {
+		if (middle.load(std::memory_order_relaxed) & Fresh) {
+			uint8_t previous = middle.exchange(front, std::memory_order_acq_rel);
+			front = previous & IndexMask;
+		}
+		return slots[front];
+	}
+
+private:
+	enum : uint8_t {
+		IndexMask = 0x3,
+		Fresh = 0x4, //set on 'middle' when it holds a value the reader hasn't seen
+	};
+	T slots[3];
+	uint8_t back = 0;
+	std::atomic< uint8_t > middle{ 1 };
+	uint8_t front = 2;
+};
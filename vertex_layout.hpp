@@ -0,0 +1,151 @@
+#pragma once
+
+//vertex_layout.hpp describes interleaved vertex formats at compile time,
+// so the glVertexAttribPointer calls for a format are generated from its
+// description instead of being written out by hand:
+//
+//   typedef VertexLayout< MyVertex,
+//   	VERTEX_ATTRIB(MyVertex, Position),
+//   	VERTEX_ATTRIB(MyVertex, Color)
+//   > MyLayout;
+//   ...
+//   glBindBuffer(GL_ARRAY_BUFFER, vbo);
+//   MyLayout::bind(position_location, color_location);
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+//---- packed storage types ----
+
+//four half-floats (GL_HALF_FLOAT):
+struct HalfVec4 {
+	uint16_t x, y, z, w;
+};
+static_assert(sizeof(HalfVec4) == 8, "HalfVec4 should be packed.");
+
+//three signed-normalized 10-bit values + a 2-bit w (GL_INT_2_10_10_10_REV):
+struct Snorm10x3 {
+	uint32_t xyzw;
+};
+static_assert(sizeof(Snorm10x3) == 4, "Snorm10x3 should be packed.");
+
+//---- attribute formats ----
+
+//AttribFormat< T > gives the (size, type, normalized) arguments to glVertexAttribPointer for storage type T:
+template< typename T >
+struct AttribFormat;
+
+template< >
+struct AttribFormat< glm::vec2 > {
+	static const GLint size = 2;
+	static const GLenum type = GL_FLOAT;
+	static const GLboolean normalized = GL_FALSE;
+};
+
+template< >
+struct AttribFormat< glm::vec3 > {
+	static const GLint size = 3;
+	static const GLenum type = GL_FLOAT;
+	static const GLboolean normalized = GL_FALSE;
+};
+
+template< >
+struct AttribFormat< glm::u8vec4 > {
+	static const GLint size = 4;
+	static const GLenum type = GL_UNSIGNED_BYTE;
+	static const GLboolean normalized = GL_TRUE;
+};
+
+template< >
+struct AttribFormat< HalfVec4 > {
+	static const GLint size = 4;
+	static const GLenum type = GL_HALF_FLOAT;
+	static const GLboolean normalized = GL_FALSE;
+};
+
+template< >
+struct AttribFormat< Snorm10x3 > {
+	static const GLint size = 4;
+	static const GLenum type = GL_INT_2_10_10_10_REV;
+	static const GLboolean normalized = GL_TRUE;
+};
+
+//---- layouts ----
+
+//One attribute of type T stored at byte Offset within each vertex:
+template< typename T, std::size_t Offset >
+struct VertexAttrib {
+	typedef AttribFormat< T > Format;
+	//points 'location' at this attribute of the currently bound GL_ARRAY_BUFFER:
+	// (locations of -1U -- i.e., attributes the program doesn't use -- are skipped)
+	static void bind(GLuint location, GLsizei stride) {
+		if (location == -1U) return;
+		glVertexAttribPointer(location, Format::size, Format::type, Format::normalized, stride, (GLbyte *)0 + Offset);
+		glEnableVertexAttribArray(location);
+	}
+};
+
+#define VERTEX_ATTRIB( VERTEX, MEMBER ) \
+	VertexAttrib< decltype(VERTEX::MEMBER), offsetof(VERTEX, MEMBER) >
+
+//A vertex format made of the listed attributes:
+template< typename Vertex, typename... Attribs >
+struct VertexLayout {
+	static_assert(sizeof...(Attribs) > 0, "Layout should have at least one attribute.");
+
+	//set up attribute pointers (one location per attribute, in order) for the currently bound GL_ARRAY_BUFFER:
+	template< typename... Locations >
+	static void bind(Locations... locations) {
+		static_assert(sizeof...(Locations) == sizeof...(Attribs), "Expecting one location per attribute.");
+		int expand[] = { (Attribs::bind(GLuint(locations), GLsizei(sizeof(Vertex))), 0)... };
+		(void)expand;
+	}
+};
+
+//---- vertex formats used by the game ----
+
+//as written by meshes/export-meshes.py (chunk 'dat0'):
+struct PosNorColVertex {
+	glm::vec3 Position;
+	glm::vec3 Normal;
+	glm::u8vec4 Color;
+	static char const *chunk_magic() { return "dat0"; }
+};
+static_assert(sizeof(PosNorColVertex) == 28, "PosNorColVertex should be packed.");
+
+typedef VertexLayout< PosNorColVertex,
+	VERTEX_ATTRIB(PosNorColVertex, Position),
+	VERTEX_ATTRIB(PosNorColVertex, Normal),
+	VERTEX_ATTRIB(PosNorColVertex, Color)
+> PosNorColLayout;
+
+//half-float position, 10:10:10 normal (chunk 'dat1', export-meshes.py with do_packed = True):
+struct PackedPosNorColVertex {
+	HalfVec4 Position;
+	Snorm10x3 Normal;
+	glm::u8vec4 Color;
+	static char const *chunk_magic() { return "dat1"; }
+};
+static_assert(sizeof(PackedPosNorColVertex) == 16, "PackedPosNorColVertex should be packed.");
+
+typedef VertexLayout< PackedPosNorColVertex,
+	VERTEX_ATTRIB(PackedPosNorColVertex, Position),
+	VERTEX_ATTRIB(PackedPosNorColVertex, Normal),
+	VERTEX_ATTRIB(PackedPosNorColVertex, Color)
+> PackedPosNorColLayout;
+
+inline PackedPosNorColVertex pack_vertex(PosNorColVertex const &v) {
+	PackedPosNorColVertex ret;
+	ret.Position.x = glm::packHalf1x16(v.Position.x);
+	ret.Position.y = glm::packHalf1x16(v.Position.y);
+	ret.Position.z = glm::packHalf1x16(v.Position.z);
+	ret.Position.w = glm::packHalf1x16(1.0f);
+	ret.Normal.xyzw = glm::packSnorm3x10_1x2(glm::vec4(v.Normal, 0.0f));
+	ret.Color = v.Color;
+	return ret;
+}